@@ -0,0 +1,154 @@
+// Parse time and allocations per response for decoder.hpp, on replies shaped like the 1.2 API's.
+// Each response is parsed and mapped the way KeyAuth::decode_response does it: one scan of the
+// top-level object, every field of "info" and its subscriptions copied out.
+//
+//   decoder_bench [--iterations=200000]
+//
+// Built twice: decoder_bench with the on-demand backend and, when jsoncpp is installed,
+// decoder_bench_jsoncpp with KEYAUTH_USE_JSONCPP, so the two can be compared side by side.
+#include "decoder.hpp"
+#include "alloc_count.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    // Keeps the decoded results observable so the loop is not optimised away
+    volatile size_t sink = 0;
+
+    struct Subscription {
+        std::string name;
+        std::string key;
+        time_t expiry = 0;
+        long long timeleft = 0;
+    };
+
+    struct Login {
+        bool success = false;
+        std::string message;
+        std::string session_id;
+        std::string username;
+        std::string ip;
+        std::string hwid;
+        time_t created = 0;
+        time_t last_login = 0;
+        std::vector<Subscription> subscriptions;
+    };
+
+    void decode(const decoder::Value& node, Subscription& out) {
+        node.each_member([&](std::string_view key, const decoder::Value& value) {
+            if (key == "subscription") out.name = value.as_string();
+            else if (key == "key") out.key = value.as_string();
+            else if (key == "expiry") out.expiry = (time_t)value.as_int();
+            else if (key == "timeleft") out.timeleft = value.as_int();
+        });
+    }
+
+    void decode_info(const decoder::Value& node, Login& out) {
+        node.each_member([&](std::string_view key, const decoder::Value& value) {
+            if (key == "username") out.username = value.as_string();
+            else if (key == "ip") out.ip = value.as_string();
+            else if (key == "hwid") out.hwid = value.as_string();
+            else if (key == "createdate") out.created = (time_t)value.as_int();
+            else if (key == "lastlogin") out.last_login = (time_t)value.as_int();
+            else if (key == "subscriptions") {
+                value.each([&](const decoder::Value& element) {
+                    out.subscriptions.emplace_back();
+                    decode(element, out.subscriptions.back());
+                });
+            }
+        });
+    }
+
+    bool decode_response(const std::string& body, Login& out) {
+        decoder::Document document;
+        if (!document.parse(body)) return false;
+
+        document.each_member([&](std::string_view key, const decoder::Value& value) {
+            if (key == "success") out.success = value.as_bool();
+            else if (key == "message") out.message = value.as_string();
+            else if (key == "sessionid") out.session_id = value.as_string();
+            else if (key == "info") decode_info(value, out);
+        });
+        return true;
+    }
+
+    const std::string subscription =
+        "{\"subscription\":\"default\",\"key\":\"KEYAUTH-XXXX-XXXX\",\"expiry\":\"1950000000\",\"timeleft\":86400}";
+
+    std::string login_reply(int subscriptions, size_t padding) {
+        std::string body = "{\"success\":true,\"message\":\"Logged in!\",\"info\":{\"username\":\"someone\",\"ip\":\"203.0.113.7\","
+                           "\"hwid\":\"S-1-5-21-1004336348-1177238915-682003330-512\",\"createdate\":\"1700000000\","
+                           "\"lastlogin\":\"1700000100\",\"subscriptions\":[";
+        for (int i = 0; i < subscriptions; ++i) body += (i ? "," : "") + subscription;
+        body += "]}";
+        if (padding) body += ",\"nonce\":\"" + std::string(padding, 'x') + "\"";
+        return body + "}";
+    }
+
+    struct Payload {
+        const char* name;
+        std::string body;
+    };
+
+    void measure(const Payload& payload, int iterations) {
+        // Warm up, and check the body actually decodes
+        Login check;
+        if (!decode_response(payload.body, check)) {
+            fprintf(stderr, "%s: does not parse\n", payload.name);
+            exit(1);
+        }
+
+        const unsigned long long allocations_before = alloc_count::this_thread();
+        const auto start = steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            Login login;
+            decode_response(payload.body, login);
+            sink = sink + login.subscriptions.size() + login.message.size();
+        }
+        const double ns = duration<double, std::nano>(steady_clock::now() - start).count() / iterations;
+        const double allocations = (double)(alloc_count::this_thread() - allocations_before) / iterations;
+
+        printf("%-22s %8zu %10.0f %10.1f %9.1f\n", payload.name, payload.body.size(), ns, payload.body.size() / ns * 1000.0,
+            allocations);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv) {
+    int iterations = 200000;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) iterations = std::max(1, atoi(argv[i] + 13));
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    const std::vector<Payload> payloads = {
+        {"init", "{\"success\":true,\"message\":\"Initialized\",\"sessionid\":\"0123456789abcdef\",\"appinfo\":{\"numUsers\":\"42\","
+                 "\"numOnlineUsers\":\"3\",\"numKeys\":\"100\",\"version\":\"1.0\",\"customerPanelLink\":\"https://keyauth.cc/panel/\"},"
+                 "\"newSession\":true,\"nonce\":\"4f0c6a0e-8b7c-4d5e-9f10-112233445566\"}"},
+        {"error", "{\"success\":false,\"message\":\"Invalid username or password\"}"},
+        {"login", login_reply(1, 0)},
+        {"login, 8 subscriptions", login_reply(8, 0)},
+        {"login, 16 KB unused", login_reply(1, 16 * 1024)},
+        {"escaped message", "{\"success\":false,\"message\":\"Line \\\"one\\\"\\nLine two \\u00e9\\u00e8 \\/ end\"}"},
+    };
+
+#ifdef KEYAUTH_USE_JSONCPP
+    printf("jsoncpp backend, %d iterations\n", iterations);
+#else
+    printf("on-demand backend, %d iterations\n", iterations);
+#endif
+    printf("%-22s %8s %10s %10s %9s\n", "response", "bytes", "ns", "MB/s", "allocs");
+    for (const auto& payload : payloads) measure(payload, iterations);
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Font atlas build time cold (FreeType rasterizes every font, font_cache::build_parallel) versus
+// warm (font_cache::build maps the atlas the previous build left in its cache file), for the
+// same fonts and sizes c_main would ask for.
+//
+//   font_atlas_bench [--runs=20] [--sizes=13,16,20,24] [--font=<ttf>]
+//
+// Each run builds a fresh ImFontAtlas. Cold runs delete the cache file first; warm runs keep
+// the one the cold runs wrote. The cache file is a temporary one, not the user's (default_path).
+#include "font_cache.hpp"
+#include "config.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+    struct options_t {
+        int runs = 20;
+        std::vector< float > sizes = { 13.f, 16.f, 20.f, 24.f };
+        std::string font = Config::FONT_PATH;
+    };
+
+    std::vector< float > parse_sizes( const char* text ) {
+        std::vector< float > sizes;
+        for ( char* end = nullptr; *text; text = *end ? end + 1 : end ) {
+            const float size = strtof( text, &end );
+            if ( end == text )
+                break;
+            if ( size > 0.f )
+                sizes.push_back( size );
+        }
+        return sizes;
+    }
+
+    // One font per size, configured like c_main::initialize
+    bool build( const options_t& options, const std::string& cache, float& ms, bool& from_cache ) {
+        ImFontAtlas atlas;
+        for ( float size : options.sizes ) {
+            ImFontConfig config;
+            config.FontBuilderFlags |= ImGuiFreeTypeBuilderFlags::ImGuiFreeTypeBuilderFlags_MonoHinting;
+            if ( !atlas.AddFontFromFileTTF( options.font.c_str( ), size, &config ) )
+                return false;
+        }
+
+        if ( !font_cache::build( &atlas, options.font, cache ) )
+            return false;
+        ms = font_cache::last_build.ms;
+        from_cache = font_cache::last_build.from_cache;
+        return true;
+    }
+
+    float percentile( std::vector< float >& values, float p ) {
+        std::sort( values.begin( ), values.end( ) );
+        return values[ImMin( values.size( ) - 1, ( size_t )( p * values.size( ) ) )];
+    }
+
+    bool run( const char* name, const options_t& options, const std::string& cache, bool cold ) {
+        std::vector< float > times;
+        for ( int i = 0; i < options.runs; ++i ) {
+            if ( cold )
+                std::remove( cache.c_str( ) );
+
+            float ms = 0.f;
+            bool from_cache = false;
+            if ( !build( options, cache, ms, from_cache ) ) {
+                fprintf( stderr, "%s: cannot build the atlas from %s\n", name, options.font.c_str( ) );
+                return false;
+            }
+            if ( from_cache == cold ) {
+                fprintf( stderr, "%s: the atlas was %s\n", name, from_cache ? "loaded from the cache" : "rasterized again" );
+                return false;
+            }
+            times.push_back( ms );
+        }
+
+        printf( "%-6s %6d %9.3f %9.3f %9.3f\n", name, options.runs, percentile( times, 0.5f ), percentile( times, 0.95f ),
+            *std::max_element( times.begin( ), times.end( ) ) );
+        return true;
+    }
+}
+
+int main( int argc, char** argv ) {
+    options_t options;
+    for ( int i = 1; i < argc; ++i ) {
+        if ( strncmp( argv[i], "--runs=", 7 ) == 0 )
+            options.runs = ImMax( 1, atoi( argv[i] + 7 ) );
+        else if ( strncmp( argv[i], "--sizes=", 8 ) == 0 )
+            options.sizes = parse_sizes( argv[i] + 8 );
+        else if ( strncmp( argv[i], "--font=", 7 ) == 0 )
+            options.font = argv[i] + 7;
+        else {
+            fprintf( stderr, "unknown option %s\n", argv[i] );
+            return 2;
+        }
+    }
+    if ( options.sizes.empty( ) ) {
+        fprintf( stderr, "--sizes needs at least one size\n" );
+        return 2;
+    }
+
+    if ( access( options.font.c_str( ), R_OK ) != 0 ) {
+        printf( "skipped: no font at %s (use --font=)\n", options.font.c_str( ) );
+        return 0;
+    }
+
+    char cache[] = "/tmp/keyauth_font_atlas_XXXXXX";
+    const int fd = mkstemp( cache );
+    if ( fd < 0 ) {
+        fprintf( stderr, "cannot create a cache file\n" );
+        return 1;
+    }
+    close( fd );
+
+    ImGui::CreateContext( );
+    printf( "%s, %zu sizes\n", options.font.c_str( ), options.sizes.size( ) );
+    printf( "%-6s %6s %9s %9s %9s\n", "build", "runs", "p50 ms", "p95 ms", "worst ms" );
+    const bool ok = run( "cold", options, cache, true ) && run( "warm", options, cache, false );
+
+    std::remove( cache );
+    ImGui::DestroyContext( );
+    return ok ? 0 : 1;
+}
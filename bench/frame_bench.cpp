@@ -0,0 +1,127 @@
+// CPU cost of c_main::render on the headless backend (headless.hpp): renders the login page and
+// the logged-in page for N frames each and reports time, vertices, indices, draw calls and ImGui
+// allocations per frame, so UI regressions show up off Windows.
+// built/cached are the window chrome vertices per frame tessellated vs replayed by g_static_layer;
+// --static-layer=off draws the chrome immediately every frame instead, for comparison.
+//
+//   frame_bench [--frames=1000] [--static-layer=off]
+//
+// KeyAuth runs on transport::keyauth_loopback( ), so no server is needed. The logged-in page is
+// reached the way a returning user reaches it: through a saved session in Config::CREDENTIALS_FILE,
+// which is written to the working directory and removed afterwards.
+#include "headless.hpp"
+#include "main.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    struct page_run_t {
+        const char* name;
+        int page;
+    };
+
+    bool ready( const c_main& main, int page ) {
+        const auto& startup = main.get_startup_stats( );
+        if ( page == 0 )
+            return startup.keyauth_init_ms >= 0.f;
+        return cur_page == 1 && startup.first_usable_frame_ms >= 0.f;
+    }
+
+    bool run( const page_run_t& run, int frames ) {
+        c_headless headless( { ( float )Config::WINDOW_WIDTH, ( float )Config::WINDOW_HEIGHT } );
+        c_main main( transport::keyauth_loopback( ) );
+        main.initialize( ImGui::GetIO( ) );
+        headless.build_fonts( );
+
+        // Let the loopback init / saved-session check land before anything is measured
+        for ( int i = 0; i < 5000 && !ready( main, run.page ); ++i ) {
+            c_headless_frame frame( headless );
+            main.render( );
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+        }
+        if ( !ready( main, run.page ) ) {
+            fprintf( stderr, "%s: page %d never became ready\n", run.name, run.page );
+            return false;
+        }
+        for ( int i = 0; i < 10; ++i ) {
+            c_headless_frame frame( headless );
+            main.render( );
+        }
+
+        headless.reset_totals( );
+        unsigned long long chrome_built = 0, chrome_cached = 0;
+        for ( int i = 0; i < frames; ++i ) {
+            {
+                c_headless_frame frame( headless );
+                main.render( );
+            }
+            // Stats of the frame before this one; new_frame( ) rolls them over
+            chrome_built += g_static_layer.get_last_frame_stats( ).vertices_built;
+            chrome_cached += g_static_layer.get_last_frame_stats( ).vertices_cached;
+        }
+
+        const auto& totals = headless.get_totals( );
+        const double n = totals.frames;
+        printf( "%-10s %7d %9.3f %9.3f %9.0f %9.0f %6.1f %8.1f %9.0f %9.0f %9.0f\n", run.name, totals.frames, totals.sum.cpu_ms / n,
+            totals.worst.cpu_ms, totals.sum.vertices / n, totals.sum.indices / n, totals.sum.draw_calls / n, totals.sum.allocations / n,
+            totals.sum.allocated_bytes / n, chrome_built / n, chrome_cached / n );
+        fflush( stdout );
+        return true;
+    }
+
+    // Each page gets its own process, so the ui/ globals (pages, fonts, cur_page) start fresh
+    bool run_isolated( const page_run_t& page, int frames ) {
+        fflush( stdout );
+        const pid_t pid = fork( );
+        if ( pid == 0 )
+            _exit( run( page, frames ) ? 0 : 1 );
+
+        int status = 0;
+        return pid > 0 && waitpid( pid, &status, 0 ) == pid && WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+    }
+}
+
+int main( int argc, char** argv ) {
+    int frames = 1000;
+    for ( int i = 1; i < argc; ++i ) {
+        if ( strncmp( argv[i], "--frames=", 9 ) == 0 )
+            frames = ImMax( 1, atoi( argv[i] + 9 ) );
+        else if ( strcmp( argv[i], "--static-layer=off" ) == 0 )
+            g_static_layer.set_enabled( false );
+        else {
+            fprintf( stderr, "unknown option %s\n", argv[i] );
+            return 2;
+        }
+    }
+
+    curl_global_init( CURL_GLOBAL_DEFAULT );
+
+    printf( "%-10s %7s %9s %9s %9s %9s %6s %8s %9s %9s %9s\n", "page", "frames", "ms", "worst ms", "vertices", "indices", "draws",
+        "allocs", "bytes", "built", "cached" );
+
+    // Login page: no saved session, so initialize( ) starts a fresh init
+    session_cache::clear( Config::CREDENTIALS_FILE );
+    bool ok = run_isolated( { "login", 0 }, frames );
+
+    // Logged-in page: a saved session bound to this machine's HWID, which the loopback accepts
+    if ( ok ) {
+        KeyAuth::Session saved;
+        saved.session_id = "loopback";
+        saved.user.username = "bench";
+        saved.user.subscriptions = { { "default", "", ( time_t )4102444800, 1 } };
+        {
+            KeyAuth probe( Config::KEYAUTH_APP_NAME, Config::KEYAUTH_APP_SECRET, Config::KEYAUTH_APP_VERSION, Config::KEYAUTH_API_URL, "",
+                Config::HWID_CACHE_FILE, "", transport::keyauth_loopback( ) );
+            ok = session_cache::save( Config::CREDENTIALS_FILE, saved, probe.get_hwid( ) );
+        }
+        ok = ok && run_isolated( { "session", 1 }, frames );
+        session_cache::clear( Config::CREDENTIALS_FILE );
+    }
+
+    curl_global_cleanup( );
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+// Latency of the first request a new client makes, which is what a user waits for at startup
+// and at the login button. Three ways to get there, against a local HTTPS mock:
+//
+//   cold     a new KeyAuth whose first init() connects and does a full TLS handshake
+//   warm     preconnect() ran beforehand (as when the user starts typing), so init() finds
+//            a pooled connection
+//   resumed  the KeyAuth got a tls_cache file from the previous run, so init()'s handshake
+//            resumes that session instead of fetching and verifying the certificate
+//
+//   keyauth_first_request [--rounds=50]
+//
+// init() is made through init_async(), the path the UI uses and the one preconnect() warms.
+// Only that call is timed; constructing the client, and the wait for the preconnect, are not.
+// Resumption needs libcurl 8.12 built with SSLS-EXPORT (see tls_cache.hpp); elsewhere that row
+// says why it was skipped. The run fails if sessions were loaded but the server never saw a
+// resumed handshake.
+#include "keyauth.hpp"
+#include "mock_server.hpp"
+
+using namespace std::chrono;
+
+namespace {
+    struct Options {
+        int rounds = 50;
+    };
+
+    double percentile(std::vector<double>& values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(p * (double)values.size()))];
+    }
+
+    void row(const char* mode, std::vector<double>& latencies, unsigned long fresh, unsigned long resumed) {
+        printf("%-8s %6zu %8.3f %8.3f %8lu %8lu\n", mode, latencies.size(), percentile(latencies, 0.50), percentile(latencies, 0.95),
+            fresh, resumed);
+        fflush(stdout);
+    }
+
+    void quiet(KeyAuth& client) {
+        KeyAuth::CallPolicy policy;
+        policy.rate_per_second = 0.0;
+        client.set_call_policy(policy);
+    }
+
+    // Times one init on a client that has done nothing else in this process
+    bool first_init(KeyAuth& client, std::vector<double>& latencies, unsigned long& fresh) {
+        const auto sent = steady_clock::now();
+        if (!client.init_async().get()) {
+            fprintf(stderr, "init failed: %s\n", client.get_last_error().c_str());
+            return false;
+        }
+        latencies.push_back(duration<double, std::milli>(steady_clock::now() - sent).count());
+        fresh += client.get_connection_stats().fresh;
+        return true;
+    }
+
+    bool cold(const mock::Server& server, const Options& options) {
+        std::vector<double> latencies;
+        unsigned long fresh = 0;
+        const unsigned long resumed = server.resumed();
+        for (int i = 0; i < options.rounds; ++i) {
+            KeyAuth client("bench", "secret", "1.0", server.url(), server.ca_file());
+            quiet(client);
+            if (!first_init(client, latencies, fresh)) return false;
+        }
+        row("cold", latencies, fresh, server.resumed() - resumed);
+        return true;
+    }
+
+    bool warm(const mock::Server& server, const Options& options) {
+        std::vector<double> latencies;
+        unsigned long fresh = 0;
+        const unsigned long resumed = server.resumed();
+        for (int i = 0; i < options.rounds; ++i) {
+            KeyAuth client("bench", "secret", "1.0", server.url(), server.ca_file());
+            quiet(client);
+            client.preconnect();
+
+            // The preconnect has finished once its connection is counted
+            const auto give_up = steady_clock::now() + seconds(5);
+            while (client.get_connection_stats().fresh == 0 && steady_clock::now() < give_up) std::this_thread::sleep_for(milliseconds(1));
+            if (client.get_connection_stats().fresh == 0) {
+                fprintf(stderr, "warm: the preconnect never completed\n");
+                return false;
+            }
+
+            // Count only what init() itself opened
+            unsigned long opened = 0;
+            if (!first_init(client, latencies, opened)) return false;
+            fresh += opened - 1;
+        }
+        row("warm", latencies, fresh, server.resumed() - resumed);
+        return true;
+    }
+
+    bool resumed(const mock::Server& server, const Options& options) {
+        char path[] = "/tmp/keyauth_tls_cache_XXXXXX";
+        const int fd = mkstemp(path);
+        if (fd < 0) {
+            fprintf(stderr, "resumed: cannot create a cache file\n");
+            return false;
+        }
+        close(fd);
+        std::remove(path);
+
+        // The previous run: its destructor writes the tickets it was sent
+        {
+            KeyAuth seed("bench", "secret", "1.0", server.url(), server.ca_file(), "", path);
+            quiet(seed);
+            if (!seed.init()) {
+                fprintf(stderr, "resumed: init failed: %s\n", seed.get_last_error().c_str());
+                return false;
+            }
+        }
+
+        std::vector<double> latencies;
+        unsigned long fresh = 0;
+        int loaded = 0;
+        const unsigned long before = server.resumed();
+        for (int i = 0; i < options.rounds; ++i) {
+            KeyAuth client("bench", "secret", "1.0", server.url(), server.ca_file(), "", path);
+            quiet(client);
+            if (client.get_connection_stats().tls_sessions_loaded == 0) break;
+            loaded++;
+            if (!first_init(client, latencies, fresh)) return false;
+        }
+        std::remove(path);
+        const unsigned long handshakes = server.resumed() - before;
+
+        if (loaded == 0) {
+#if LIBCURL_VERSION_NUM >= 0x080c00
+            printf("%-8s skipped: libcurl %s was built without SSLS-EXPORT\n", "resumed", curl_version_info(CURLVERSION_NOW)->version);
+#else
+            printf("%-8s skipped: built against libcurl %s, the TLS cache needs 8.12\n", "resumed", LIBCURL_VERSION);
+#endif
+            return true;
+        }
+        row("resumed", latencies, fresh, handshakes);
+        if (handshakes == 0) {
+            fprintf(stderr, "resumed: %d clients loaded TLS sessions but no handshake resumed\n", loaded);
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--rounds=", 9) == 0) options.rounds = std::max(1, atoi(argv[i] + 9));
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+#ifndef KEYAUTH_MOCK_TLS
+    printf("skipped: the mock was built without KEYAUTH_MOCK_TLS, and there is no handshake to save over HTTP\n");
+    return 0;
+#else
+    mock::Server server(mock::keyauth_api, true);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    printf("HTTPS mock, libcurl %s\n", curl_version_info(CURLVERSION_NOW)->version);
+    printf("%-8s %6s %8s %8s %8s %8s\n", "start", "rounds", "p50 ms", "p95 ms", "fresh", "resumed");
+
+    const bool ok = cold(server, options) && warm(server, options) && resumed(server, options);
+
+    curl_global_cleanup();
+    return ok ? 0 : 1;
+#endif
+}
@@ -0,0 +1,190 @@
+// Latency of init, login, license_login and register_user against a local HTTPS mock of the
+// 1.2 API, at 1, 2, 4 ... --clients concurrent KeyAuth instances (one thread each). Reports
+// p50/p95/p99, throughput and allocations per call; the baseline for changes to make_request
+// and response handling.
+//
+//   keyauth_latency [--clients=8] [--calls=200] [--latency=0] [--jitter=0] [--payload=0]
+//                   [--errors=0] [--http]
+//
+// --latency/--jitter (ms) delay every reply by latency + U(-jitter, jitter), --payload pads each
+// reply with that many bytes of an unused field, and --errors is the fraction of replies that
+// are 503s. The server runs in a child process (mock::Process), so its threads, CPU time and
+// allocations stay out of the numbers. Allocations are operator new in this process plus
+// libcurl's mallocs.
+#include "keyauth.hpp"
+#include "alloc_count.hpp"
+#include "mock_server.hpp"
+
+#include <random>
+
+using namespace std::chrono;
+
+namespace {
+    struct Options {
+        int clients = 8;
+        int calls = 200;
+        int latency_ms = 0;
+        int jitter_ms = 0;
+        size_t payload = 0;
+        double errors = 0.0;
+        bool tls = true;
+    };
+
+    std::atomic<unsigned long long> curl_allocations{0};
+
+    void* count_malloc(size_t size) { curl_allocations++; return malloc(size); }
+    void* count_realloc(void* p, size_t size) { curl_allocations++; return realloc(p, size); }
+    void* count_calloc(size_t count, size_t size) { curl_allocations++; return calloc(count, size); }
+    char* count_strdup(const char* s) { curl_allocations++; return strdup(s); }
+
+    unsigned long long allocations() {
+        return alloc_count::total() + curl_allocations.load();
+    }
+
+    mock::Handler scripted_api(const Options& options) {
+        return [options](const mock::Request& request, mock::Reply& reply) {
+            thread_local std::mt19937 random{std::random_device{}()};
+
+            int delay = options.latency_ms;
+            if (options.jitter_ms > 0) delay += std::uniform_int_distribution<int>(-options.jitter_ms, options.jitter_ms)(random);
+            reply.delay = milliseconds(std::max(delay, 0));
+
+            if (options.errors > 0 && std::uniform_real_distribution<double>(0, 1)(random) < options.errors) {
+                reply.status = 503;
+                return;
+            }
+
+            mock::keyauth_api(request, reply);
+            if (options.payload > 0) reply.body.insert(reply.body.size() - 1, ",\"padding\":\"" + std::string(options.payload, 'x') + "\"");
+        };
+    }
+
+    enum class Call { init, login, license_login, register_user };
+
+    const char* name(Call call) {
+        switch (call) {
+            case Call::init: return "init";
+            case Call::login: return "login";
+            case Call::license_login: return "license_login";
+            case Call::register_user: return "register_user";
+        }
+        return "";
+    }
+
+    bool run(KeyAuth& client, Call call) {
+        switch (call) {
+            case Call::init: return client.init();
+            case Call::login: return client.login("user", "pass").success;
+            case Call::license_login: return client.license_login("XXXX-XXXX-XXXX").success;
+            case Call::register_user: return client.register_user("user", "pass", "XXXX-XXXX-XXXX").success;
+        }
+        return false;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * (double)sorted.size()))];
+    }
+
+    void measure(std::vector<std::unique_ptr<KeyAuth>>& clients, Call call, int calls) {
+        const size_t count = clients.size();
+        std::vector<std::vector<double>> latencies(count);
+        for (auto& list : latencies) list.reserve((size_t)calls);
+        std::atomic<unsigned long> failures{0};
+
+        const unsigned long long allocations_before = allocations();
+        const auto start = steady_clock::now();
+
+        std::vector<std::thread> threads;
+        threads.reserve(count);
+        for (size_t c = 0; c < count; ++c) {
+            threads.emplace_back([&, c] {
+                for (int i = 0; i < calls; ++i) {
+                    const auto sent = steady_clock::now();
+                    if (!run(*clients[c], call)) failures++;
+                    latencies[c].push_back(duration<double, std::milli>(steady_clock::now() - sent).count());
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        const double seconds = duration<double>(steady_clock::now() - start).count();
+        const double total = (double)count * calls;
+        // The thread objects themselves are the only allocations made by the benchmark
+        const double allocations_per_call = (double)(allocations() - allocations_before - count) / total;
+
+        std::vector<double> all;
+        all.reserve((size_t)total);
+        for (const auto& list : latencies) all.insert(all.end(), list.begin(), list.end());
+        std::sort(all.begin(), all.end());
+
+        printf("%-14s %7zu %8.0f %8.3f %8.3f %8.3f %10.0f %9.1f %8lu\n", name(call), count, total,
+            percentile(all, 0.50), percentile(all, 0.95), percentile(all, 0.99), total / seconds, allocations_per_call,
+            failures.load());
+        fflush(stdout);
+    }
+
+    bool parse(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const size_t equals = arg.find('=');
+            const std::string key = arg.substr(0, equals);
+            const char* value = equals == std::string::npos ? "" : argv[i] + equals + 1;
+
+            if (key == "--clients") options.clients = std::max(1, atoi(value));
+            else if (key == "--calls") options.calls = std::max(1, atoi(value));
+            else if (key == "--latency") options.latency_ms = atoi(value);
+            else if (key == "--jitter") options.jitter_ms = atoi(value);
+            else if (key == "--payload") options.payload = (size_t)std::max(0, atoi(value));
+            else if (key == "--errors") options.errors = atof(value);
+            else if (key == "--http") options.tls = false;
+            else {
+                fprintf(stderr, "unknown option %s\n", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) return 2;
+#ifndef KEYAUTH_MOCK_TLS
+    options.tls = false;
+#endif
+
+    mock::Process server(scripted_api(options), options.tls);
+    curl_global_init_mem(CURL_GLOBAL_DEFAULT, count_malloc, free, count_realloc, count_strdup, count_calloc);
+
+    printf("%s mock, latency %d ms +/- %d ms, payload %zu bytes, %.0f%% errors\n", options.tls ? "HTTPS" : "HTTP",
+        options.latency_ms, options.jitter_ms, options.payload, options.errors * 100);
+    printf("%-14s %7s %8s %8s %8s %8s %10s %9s %8s\n", "call", "clients", "calls", "p50 ms", "p95 ms", "p99 ms",
+        "calls/s", "allocs", "failed");
+
+    KeyAuth::CallPolicy policy;
+    policy.rate_per_second = 0.0;
+    policy.breaker_threshold = std::numeric_limits<int>::max();
+
+    for (int level = 1;; level = std::min(level * 2, options.clients)) {
+        std::vector<std::unique_ptr<KeyAuth>> clients;
+        for (int c = 0; c < level; ++c) {
+            clients.push_back(std::make_unique<KeyAuth>("bench", "secret", "1.0", server.url(), server.ca_file()));
+            clients.back()->set_call_policy(policy);
+            // Connect, handshake and open a session before anything is timed
+            if (!clients.back()->init() && options.errors == 0) {
+                fprintf(stderr, "init failed: %s\n", clients.back()->get_last_error().c_str());
+                return 1;
+            }
+        }
+
+        for (Call call : {Call::init, Call::login, Call::license_login, Call::register_user}) {
+            measure(clients, call, options.calls);
+        }
+
+        if (level == options.clients) break;
+    }
+
+    curl_global_cleanup();
+    return 0;
+}
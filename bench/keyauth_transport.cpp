@@ -0,0 +1,132 @@
+// Wall time for N independent calls sent one after another on the blocking easy-handle path
+// (login()) versus all at once through the curl_multi engine (login_async()), against a local
+// mock that answers after a fixed latency.
+//
+//   keyauth_transport [--calls=16] [--latency=20] [--rounds=5] [--http]
+//
+// Each round logs in N distinct users, so single-flight never merges them. The mock speaks
+// HTTP/1.1 only: the engine's concurrency here comes from parallel connections, not HTTP/2
+// streams. Reported times are the median round.
+#include "keyauth.hpp"
+#include "mock_server.hpp"
+
+using namespace std::chrono;
+
+namespace {
+    struct Options {
+        int calls = 16;
+        int latency_ms = 20;
+        int rounds = 5;
+        bool tls = true;
+    };
+
+    struct Round {
+        double ms = 0.0;
+        unsigned long failures = 0;
+    };
+
+    std::string user(int i) {
+        return "user" + std::to_string(i);
+    }
+
+    Round sequential(KeyAuth& client, int calls) {
+        Round round;
+        const auto start = steady_clock::now();
+        for (int i = 0; i < calls; ++i) {
+            if (!client.login(user(i), "pass").success) round.failures++;
+        }
+        round.ms = duration<double, std::milli>(steady_clock::now() - start).count();
+        return round;
+    }
+
+    Round multi(KeyAuth& client, int calls) {
+        Round round;
+        std::vector<std::future<KeyAuth::AuthResult>> pending;
+        pending.reserve((size_t)calls);
+
+        const auto start = steady_clock::now();
+        for (int i = 0; i < calls; ++i) pending.push_back(client.login_async(user(i), "pass"));
+        for (auto& result : pending) {
+            if (!result.get().success) round.failures++;
+        }
+        round.ms = duration<double, std::milli>(steady_clock::now() - start).count();
+        return round;
+    }
+
+    // Prints the median round and returns its wall time
+    double report(const char* name, std::vector<Round> rounds, int calls, unsigned long connections) {
+        std::sort(rounds.begin(), rounds.end(), [](const Round& a, const Round& b) { return a.ms < b.ms; });
+        const Round& median = rounds[rounds.size() / 2];
+        unsigned long failures = 0;
+        for (const auto& round : rounds) failures += round.failures;
+
+        printf("%-12s %10.1f %12.2f %12lu %8lu\n", name, median.ms, median.ms / calls, connections, failures);
+        fflush(stdout);
+        return median.ms;
+    }
+
+    bool parse(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const size_t equals = arg.find('=');
+            const std::string key = arg.substr(0, equals);
+            const char* value = equals == std::string::npos ? "" : argv[i] + equals + 1;
+
+            if (key == "--calls") options.calls = std::max(1, atoi(value));
+            else if (key == "--latency") options.latency_ms = std::max(0, atoi(value));
+            else if (key == "--rounds") options.rounds = std::max(1, atoi(value));
+            else if (key == "--http") options.tls = false;
+            else {
+                fprintf(stderr, "unknown option %s\n", arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) return 2;
+#ifndef KEYAUTH_MOCK_TLS
+    options.tls = false;
+#endif
+
+    const milliseconds latency(options.latency_ms);
+    mock::Process server([latency](const mock::Request& request, mock::Reply& reply) {
+        if (transport::param(request.body, "type") != "init") reply.delay = latency;
+        mock::keyauth_api(request, reply);
+    }, options.tls);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    KeyAuth client("bench", "secret", "1.0", server.url(), server.ca_file());
+    KeyAuth::CallPolicy policy;
+    policy.rate_per_second = 0.0;
+    client.set_call_policy(policy);
+    if (!client.init()) {
+        fprintf(stderr, "init failed: %s\n", client.get_last_error().c_str());
+        return 1;
+    }
+
+    printf("%s mock, %d calls per round, %d ms server latency, median of %d rounds\n", options.tls ? "HTTPS" : "HTTP",
+        options.calls, options.latency_ms, options.rounds);
+    printf("%-12s %10s %12s %12s %8s\n", "path", "wall ms", "ms per call", "new conns", "failed");
+
+    // Warm both paths' connections before anything is timed
+    sequential(client, 1);
+    multi(client, options.calls);
+
+    std::vector<Round> rounds;
+    unsigned long opened = client.get_connection_stats().fresh;
+    for (int r = 0; r < options.rounds; ++r) rounds.push_back(sequential(client, options.calls));
+    const double sequential_ms = report("sequential", rounds, options.calls, client.get_connection_stats().fresh - opened);
+
+    rounds.clear();
+    opened = client.get_connection_stats().fresh;
+    for (int r = 0; r < options.rounds; ++r) rounds.push_back(multi(client, options.calls));
+    const double multi_ms = report("multi", rounds, options.calls, client.get_connection_stats().fresh - opened);
+    printf("speedup      %10.1fx\n", sequential_ms / multi_ms);
+
+    curl_global_cleanup();
+    return 0;
+}
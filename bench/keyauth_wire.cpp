@@ -0,0 +1,144 @@
+// Bytes on the wire and time to response for init and login in both transport modes:
+// compatible (HTTP/1.1, uncompressed) and optimized (HTTP/2 through ALPN, gzip). The server is
+// a local HTTPS mock that offers h2 and gzip (mock::Server with Options::http2/gzip); bytes are
+// counted at its sockets, so TLS records, HTTP/2 framing and headers are all included.
+//
+//   keyauth_wire [--calls=200] [--subscriptions=4]
+//
+// Replies are shaped like the 1.2 API's: init carries appinfo and a nonce, login one entry per
+// --subscriptions with its own key. "connect" is the first init on a new client, TLS handshake
+// included; the other rows are per call on the warm connection. On loopback there is no round
+// trip to save, so the time columns show what HTTP/2 and decompression cost in CPU; the byte
+// columns are what a real link has to carry.
+#include "keyauth.hpp"
+#include "mock_server.hpp"
+
+#include <random>
+
+using namespace std::chrono;
+
+namespace {
+    struct Options {
+        int calls = 200;
+        int subscriptions = 4;
+    };
+
+    std::string random_hex(std::mt19937& random, size_t size) {
+        std::string text;
+        for (size_t i = 0; i < size; ++i) text += hex::digits[random() & 0x0F];
+        return text;
+    }
+
+    mock::Handler api(const Options& options) {
+        return [options](const mock::Request& request, mock::Reply& reply) {
+            thread_local std::mt19937 random{std::random_device{}()};
+            const std::string_view type = transport::param(request.body, "type");
+
+            if (type == "init") {
+                reply.body = "{\"success\":true,\"message\":\"Initialized\",\"sessionid\":\"" + random_hex(random, 32) +
+                             "\",\"appinfo\":{\"numUsers\":\"1204\",\"numOnlineUsers\":\"37\",\"numKeys\":\"5120\",\"version\":\"1.0\","
+                             "\"customerPanelLink\":\"https://keyauth.cc/panel/bench/bench/\"},\"newSession\":true,\"nonce\":\"" +
+                             random_hex(random, 36) + "\"}";
+                return;
+            }
+            if (type != "login") {
+                mock::keyauth_api(request, reply);
+                return;
+            }
+
+            reply.body = "{\"success\":true,\"message\":\"Logged in!\",\"info\":{\"username\":\"user\",\"subscriptions\":[";
+            for (int i = 0; i < options.subscriptions; ++i) {
+                reply.body += std::string(i ? "," : "") + "{\"subscription\":\"tier-" + std::to_string(i) + "\",\"key\":\"KEYAUTH-" +
+                              random_hex(random, 6) + "-" + random_hex(random, 6) + "\",\"expiry\":\"" + std::to_string(1900000000 + i * 86400) +
+                              "\",\"timeleft\":" + std::to_string(86400 * (i + 1)) + "}";
+            }
+            reply.body += "],\"ip\":\"203.0.113.7\",\"hwid\":\"S-1-5-21-1004336348-1177238915-682003330-512\",\"createdate\":\"1700000000\","
+                          "\"lastlogin\":\"1700000100\"},\"nonce\":\"" + random_hex(random, 36) + "\"}";
+        };
+    }
+
+    double percentile(std::vector<double>& values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, (size_t)(p * (double)values.size()))];
+    }
+
+    void row(const char* mode, const char* call, int calls, std::vector<double>& latencies, unsigned long long up, unsigned long long down,
+             unsigned long http2) {
+        printf("%-11s %-8s %6d %8.3f %8.3f %9.0f %9.0f %6lu\n", mode, call, calls, percentile(latencies, 0.50), percentile(latencies, 0.95),
+            (double)up / calls, (double)down / calls, http2);
+        fflush(stdout);
+    }
+
+    bool measure(const mock::Server& server, KeyAuth::TransportMode mode, const Options& options) {
+        const char* name = mode == KeyAuth::TransportMode::optimized ? "optimized" : "compatible";
+        KeyAuth client("bench", "secret", "1.0", server.url(), server.ca_file());
+        KeyAuth::CallPolicy policy;
+        policy.rate_per_second = 0.0;
+        client.set_call_policy(policy);
+        client.set_transport_mode(mode);
+
+        unsigned long long up = server.bytes_received(), down = server.bytes_sent();
+        unsigned long http2 = client.get_connection_stats().http2;
+        auto sent = steady_clock::now();
+        if (!client.init()) {
+            fprintf(stderr, "%s: init failed: %s\n", name, client.get_last_error().c_str());
+            return false;
+        }
+        std::vector<double> connect = { duration<double, std::milli>(steady_clock::now() - sent).count() };
+        row(name, "connect", 1, connect, server.bytes_received() - up, server.bytes_sent() - down, client.get_connection_stats().http2 - http2);
+
+        for (const char* call : {"init", "login"}) {
+            std::vector<double> latencies;
+            latencies.reserve((size_t)options.calls);
+            up = server.bytes_received();
+            down = server.bytes_sent();
+            http2 = client.get_connection_stats().http2;
+
+            for (int i = 0; i < options.calls; ++i) {
+                sent = steady_clock::now();
+                const bool ok = call[0] == 'i' ? client.init() : client.login("user", "pass").success;
+                if (!ok) {
+                    fprintf(stderr, "%s: %s failed\n", name, call);
+                    return false;
+                }
+                latencies.push_back(duration<double, std::milli>(steady_clock::now() - sent).count());
+            }
+            row(name, call, options.calls, latencies, server.bytes_received() - up, server.bytes_sent() - down,
+                client.get_connection_stats().http2 - http2);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--calls=", 8) == 0) options.calls = std::max(1, atoi(argv[i] + 8));
+        else if (strncmp(argv[i], "--subscriptions=", 16) == 0) options.subscriptions = std::max(0, atoi(argv[i] + 16));
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    // Whatever the mock was built with; without TLS optimized mode stays on HTTP/1.1
+    mock::Options server_options;
+#ifdef KEYAUTH_MOCK_TLS
+    server_options.tls = server_options.http2 = true;
+#endif
+#ifdef KEYAUTH_MOCK_GZIP
+    server_options.gzip = true;
+#endif
+    mock::Server server(api(options), server_options);
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    printf("%s mock%s%s, %d subscriptions per login\n", server_options.tls ? "HTTPS" : "HTTP", server_options.http2 ? ", h2" : "",
+        server_options.gzip ? ", gzip" : "", options.subscriptions);
+    printf("%-11s %-8s %6s %8s %8s %9s %9s %6s\n", "mode", "call", "calls", "p50 ms", "p95 ms", "up B", "down B", "h2");
+
+    const bool ok = measure(server, KeyAuth::TransportMode::compatible, options) && measure(server, KeyAuth::TransportMode::optimized, options);
+
+    curl_global_cleanup();
+    return ok ? 0 : 1;
+}
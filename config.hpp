@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <chrono>
 
 namespace Config {
     // KeyAuth Application Settings
@@ -8,16 +9,46 @@ namespace Config {
     inline const std::string KEYAUTH_APP_SECRET = "YourAppSecret"; // This is the Owner ID from KeyAuth
     inline const std::string KEYAUTH_APP_VERSION = "1.0";
     
+    // API endpoint and optional CA bundle (PEM path, empty = system store). Point these at a
+    // local mock server with a self-signed certificate to benchmark or test the client.
+    inline const std::string KEYAUTH_API_URL = "https://keyauth.win/api/1.2/";
+    inline const std::string KEYAUTH_CA_BUNDLE = "";
+    
+    // HTTP/2 and compressed responses when the server supports them; false forces plain
+    // HTTP/1.1. Either way the client falls back to HTTP/1.1 on its own if the server mishandles them.
+    inline const bool KEYAUTH_OPTIMIZED_TRANSPORT = true;
+    
     // Application Settings
     inline const std::string APP_TITLE = "pooron.solutions";
     inline const int WINDOW_WIDTH = 800;
     inline const int WINDOW_HEIGHT = 600;
     
     // UI Settings
+#ifdef _WIN32
     inline const std::string FONT_PATH = "C:\\Windows\\Fonts\\tahoma.ttf";
+#else
+    inline const std::string FONT_PATH = "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"; // headless builds (headless.hpp)
+#endif
     inline const int FONT_SIZE = 13;
     
     // Session Settings
     inline const bool REMEMBER_CREDENTIALS = true;
     inline const std::string CREDENTIALS_FILE = "saved_creds.dat";
+    inline const std::string HWID_CACHE_FILE = "hwid.cache"; // hardware fingerprint, recomputed if the machine id changes
+    inline const std::string TLS_CACHE_FILE = "tls.cache";   // TLS session tickets for a resumed first handshake (libcurl 8.12+)
+    
+    // Ed25519 public key (64 hex chars) from the seller dashboard. When set, a saved session is only
+    // resumed if its signed license token verifies, and within OFFLINE_GRACE of signing it is trusted
+    // without waiting for the server. Empty disables offline validation; needs KEYAUTH_OFFLINE_LICENSE.
+    inline const std::string LICENSE_PUBLIC_KEY = "";
+    inline const std::chrono::seconds OFFLINE_GRACE{72 * 60 * 60};
+    
+    // Adds a "Diagnostics" button to the main page with live per-endpoint network timings
+    inline const bool SHOW_DIAGNOSTICS = false;
+    
+    // Chrome/Perfetto timeline written at exit (and from the diagnostics page) in builds with KEYAUTH_TRACE
+    inline const std::string TRACE_FILE = "trace.json";
+    
+    // How often a logged-in session is re-checked with the server in the background
+    inline const std::chrono::milliseconds HEARTBEAT_INTERVAL{60000};
 }
\ No newline at end of file
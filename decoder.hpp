@@ -0,0 +1,444 @@
+#pragma once
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <cstdlib>
+#include <string_view>
+
+#ifdef KEYAUTH_USE_JSONCPP
+#include <memory>
+#include <json/json.h>
+#endif
+
+// Response decoding for the KeyAuth client.
+//
+// The default backend is an on-demand reader: parse() validates the buffer in a single
+// pass without allocating, and lookups scan straight to the requested field, so only
+// the handful of values we actually read are ever materialised as strings.
+// each_member()/each() visit an object or array in one forward scan, for mapping a whole
+// response into a struct without re-scanning from the start for every field.
+// Define KEYAUTH_USE_JSONCPP to build a full jsoncpp DOM behind the same interface.
+namespace decoder {
+
+#ifndef KEYAUTH_USE_JSONCPP
+
+class Value {
+private:
+    const char* cur = nullptr;
+    const char* end = nullptr;
+    
+    static constexpr int max_depth = 64;
+    
+    static const char* skip_ws(const char* p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+        return p;
+    }
+    
+    static const char* skip_literal(const char* p, const char* end, const char* literal) {
+        size_t len = strlen(literal);
+        if ((size_t)(end - p) < len || memcmp(p, literal, len) != 0) return nullptr;
+        return p + len;
+    }
+    
+    // p points at the opening quote; returns one past the closing quote
+    static const char* skip_string(const char* p, const char* end) {
+        for (++p; p < end; ++p) {
+            if (*p == '"') return p + 1;
+            if (*p == '\\') {
+                if (++p >= end) return nullptr;
+            } else if ((unsigned char)*p < 0x20) {
+                return nullptr;
+            }
+        }
+        return nullptr;
+    }
+    
+    static const char* skip_number(const char* p, const char* end) {
+        const char* start = p;
+        bool digits = false;
+        while (p < end) {
+            char c = *p;
+            if (c >= '0' && c <= '9') digits = true;
+            else if (c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') break;
+            ++p;
+        }
+        return digits && p != start ? p : nullptr;
+    }
+    
+    static const char* skip_value(const char* p, const char* end, int depth) {
+        if (p >= end || depth > max_depth) return nullptr;
+        
+        switch (*p) {
+        case '"':
+            return skip_string(p, end);
+        case 't':
+            return skip_literal(p, end, "true");
+        case 'f':
+            return skip_literal(p, end, "false");
+        case 'n':
+            return skip_literal(p, end, "null");
+        case '{':
+        case '[': {
+            const bool object = *p == '{';
+            const char close = object ? '}' : ']';
+            
+            p = skip_ws(p + 1, end);
+            if (p < end && *p == close) return p + 1;
+            
+            for (;;) {
+                if (object) {
+                    if (p >= end || *p != '"') return nullptr;
+                    p = skip_string(p, end);
+                    if (!p) return nullptr;
+                    p = skip_ws(p, end);
+                    if (p >= end || *p != ':') return nullptr;
+                    p = skip_ws(p + 1, end);
+                }
+                
+                p = skip_value(p, end, depth + 1);
+                if (!p) return nullptr;
+                
+                p = skip_ws(p, end);
+                if (p >= end) return nullptr;
+                if (*p == close) return p + 1;
+                if (*p != ',') return nullptr;
+                p = skip_ws(p + 1, end);
+            }
+        }
+        default:
+            return skip_number(p, end);
+        }
+    }
+    
+    static void append_utf8(std::string& out, unsigned long cp) {
+        if (cp < 0x80) {
+            out += (char)cp;
+        } else if (cp < 0x800) {
+            out += (char)(0xC0 | (cp >> 6));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char)(0xE0 | (cp >> 12));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        } else {
+            out += (char)(0xF0 | (cp >> 18));
+            out += (char)(0x80 | ((cp >> 12) & 0x3F));
+            out += (char)(0x80 | ((cp >> 6) & 0x3F));
+            out += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+    
+    static bool read_hex4(const char* p, const char* end, unsigned long& out) {
+        if (end - p < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = p[i];
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+    
+    friend class Document;
+
+public:
+    Value() = default;
+    Value(const char* begin, const char* end) : cur(begin), end(end) {}
+    
+    bool valid() const {
+        return cur != nullptr && *cur != 'n';
+    }
+    
+    // Member lookup; returns an invalid Value if this is not an object or the key is missing
+    Value operator[](const char* key) const {
+        if (!cur || *cur != '{') return {};
+        
+        const size_t key_len = strlen(key);
+        const char* p = skip_ws(cur + 1, end);
+        
+        while (p < end && *p == '"') {
+            const char* name = p + 1;
+            const char* name_end = skip_string(p, end);
+            if (!name_end) return {};
+            
+            p = skip_ws(name_end, end);
+            if (p >= end || *p != ':') return {};
+            p = skip_ws(p + 1, end);
+            
+            // Field names we look up are plain ASCII, so escaped keys never need decoding
+            if ((size_t)(name_end - 1 - name) == key_len && memcmp(name, key, key_len) == 0) {
+                return Value(p, end);
+            }
+            
+            p = skip_value(p, end, 0);
+            if (!p) return {};
+            p = skip_ws(p, end);
+            if (p >= end || *p != ',') return {};
+            p = skip_ws(p + 1, end);
+        }
+        
+        return {};
+    }
+    
+    // Array element lookup; returns an invalid Value if out of range
+    Value operator[](int index) const {
+        if (!cur || *cur != '[' || index < 0) return {};
+        
+        const char* p = skip_ws(cur + 1, end);
+        if (p < end && *p == ']') return {};
+        
+        for (int i = 0; p < end; ++i) {
+            if (i == index) return Value(p, end);
+            
+            p = skip_value(p, end, 0);
+            if (!p) return {};
+            p = skip_ws(p, end);
+            if (p >= end || *p != ',') return {};
+            p = skip_ws(p + 1, end);
+        }
+        
+        return {};
+    }
+    
+    size_t size() const {
+        if (!cur || *cur != '[') return 0;
+        
+        const char* p = skip_ws(cur + 1, end);
+        if (p < end && *p == ']') return 0;
+        
+        size_t count = 0;
+        while (p && p < end) {
+            p = skip_value(p, end, 0);
+            if (!p) break;
+            ++count;
+            p = skip_ws(p, end);
+            if (p >= end || *p != ',') break;
+            p = skip_ws(p + 1, end);
+        }
+        
+        return count;
+    }
+    
+    // Calls fn(key, value) for every member of an object, in document order
+    template<class Fn>
+    void each_member(Fn&& fn) const {
+        if (!cur || *cur != '{') return;
+        
+        const char* p = skip_ws(cur + 1, end);
+        while (p < end && *p == '"') {
+            const char* name = p + 1;
+            const char* name_end = skip_string(p, end);
+            if (!name_end) return;
+            
+            p = skip_ws(name_end, end);
+            if (p >= end || *p != ':') return;
+            p = skip_ws(p + 1, end);
+            
+            fn(std::string_view(name, name_end - 1 - name), Value(p, end));
+            
+            p = skip_value(p, end, 0);
+            if (!p) return;
+            p = skip_ws(p, end);
+            if (p >= end || *p != ',') return;
+            p = skip_ws(p + 1, end);
+        }
+    }
+    
+    // Calls fn(value) for every element of an array
+    template<class Fn>
+    void each(Fn&& fn) const {
+        if (!cur || *cur != '[') return;
+        
+        const char* p = skip_ws(cur + 1, end);
+        if (p < end && *p == ']') return;
+        
+        while (p < end) {
+            fn(Value(p, end));
+            
+            p = skip_value(p, end, 0);
+            if (!p) return;
+            p = skip_ws(p, end);
+            if (p >= end || *p != ',') return;
+            p = skip_ws(p + 1, end);
+        }
+    }
+    
+    bool as_bool() const {
+        return cur && skip_literal(cur, end, "true") != nullptr;
+    }
+    
+    // Accepts numbers and numeric strings, since the API sends timestamps either way; 0 otherwise
+    long long as_int() const {
+        if (!cur) return 0;
+        
+        const char* p = *cur == '"' ? cur + 1 : cur;
+        if (p >= end || !(*p == '-' || (*p >= '0' && *p <= '9'))) return 0;
+        return strtoll(p, nullptr, 10);
+    }
+    
+    // Strings are unescaped; numbers and booleans come back as their literal text
+    std::string as_string() const {
+        std::string out;
+        if (!cur) return out;
+        
+        if (*cur != '"') {
+            if (*cur == '{' || *cur == '[' || *cur == 'n') return out;
+            const char* value_end = skip_value(cur, end, 0);
+            if (value_end) out.assign(cur, value_end);
+            return out;
+        }
+        
+        const char* p = cur + 1;
+        const char* run = p;
+        for (; p < end && *p != '"'; ++p) {
+            if (*p != '\\') continue;
+            
+            out.append(run, p);
+            if (++p >= end) break;
+            
+            switch (*p) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned long cp = 0;
+                if (!read_hex4(p + 1, end, cp)) return out;
+                p += 4;
+                
+                unsigned long low = 0;
+                if (cp >= 0xD800 && cp <= 0xDBFF && end - p > 6 && p[1] == '\\' && p[2] == 'u' && read_hex4(p + 3, end, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                append_utf8(out, cp);
+                break;
+            }
+            default: out += *p; break;
+            }
+            run = p + 1;
+        }
+        out.append(run, p);
+        
+        return out;
+    }
+};
+
+class Document {
+private:
+    Value root;
+
+public:
+    // The document points into data, which must outlive it
+    bool parse(const std::string& data) {
+        const char* begin = data.data();
+        const char* end = begin + data.size();
+        
+        const char* p = Value::skip_ws(begin, end);
+        const char* after = Value::skip_value(p, end, 0);
+        if (!after || Value::skip_ws(after, end) != end) return false;
+        
+        root = Value(p, end);
+        return true;
+    }
+    
+    Value operator[](const char* key) const {
+        return root[key];
+    }
+    
+    template<class Fn>
+    void each_member(Fn&& fn) const {
+        root.each_member(fn);
+    }
+};
+
+#else
+
+class Value {
+private:
+    const Json::Value* node = nullptr;
+
+public:
+    Value() = default;
+    explicit Value(const Json::Value* node) : node(node) {}
+    
+    bool valid() const {
+        return node && !node->isNull();
+    }
+    
+    Value operator[](const char* key) const {
+        if (!node || !node->isObject()) return {};
+        return Value(node->find(key, key + strlen(key)));
+    }
+    
+    Value operator[](int index) const {
+        if (!node || !node->isArray() || index < 0 || (Json::ArrayIndex)index >= node->size()) return {};
+        return Value(&(*node)[(Json::ArrayIndex)index]);
+    }
+    
+    size_t size() const {
+        return node && node->isArray() ? node->size() : 0;
+    }
+    
+    template<class Fn>
+    void each_member(Fn&& fn) const {
+        if (!node || !node->isObject()) return;
+        for (auto it = node->begin(); it != node->end(); ++it) {
+            const char* key_end = nullptr;
+            const char* key = it.memberName(&key_end);
+            fn(std::string_view(key, key_end - key), Value(&*it));
+        }
+    }
+    
+    template<class Fn>
+    void each(Fn&& fn) const {
+        if (!node || !node->isArray()) return;
+        for (const Json::Value& element : *node) fn(Value(&element));
+    }
+    
+    bool as_bool() const {
+        return node && node->isBool() && node->asBool();
+    }
+    
+    long long as_int() const {
+        if (!node) return 0;
+        if (node->isIntegral()) return node->asInt64();
+        if (node->isDouble()) return (long long)node->asDouble();
+        if (node->isString()) return strtoll(node->asCString(), nullptr, 10);
+        return 0;
+    }
+    
+    std::string as_string() const {
+        if (!node || node->isNull() || node->isObject() || node->isArray()) return "";
+        return node->asString();
+    }
+};
+
+class Document {
+private:
+    Json::Value root;
+
+public:
+    bool parse(const std::string& data) {
+        Json::CharReaderBuilder builder;
+        std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        return reader->parse(data.data(), data.data() + data.size(), &root, nullptr);
+    }
+    
+    Value operator[](const char* key) const {
+        return Value(&root)[key];
+    }
+    
+    template<class Fn>
+    void each_member(Fn&& fn) const {
+        Value(&root).each_member(fn);
+    }
+};
+
+#endif
+
+}
\ No newline at end of file
@@ -0,0 +1,444 @@
+#pragma once
+#include "imgui/imgui.h"
+#include "imgui/imgui_freetype.h"
+#include "trace.hpp"
+#include <string>
+#include <vector>
+#include <future>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Font atlas pipeline: each font is rasterized by FreeType into its own atlas on a worker
+// thread, the results are stitched into the real atlas, and the finished pixels plus glyph
+// tables are written to a cache file whose header carries a key of the font data, sizes and
+// builder flags. Later launches with the same key map that file instead of rasterizing.
+//
+// There is one cache file, replaced whenever the key changes, so switching sizes never piles
+// up atlases. It lives in the per-user cache directory (default_path), not the working
+// directory, which may be anywhere and is often not writable.
+//
+// Neither path goes through ImFontAtlas::Build, so both finish the atlas the way it would:
+// every font is linked back to the atlas and its configs, and the texture is marked ready.
+namespace font_cache {
+    struct build_stats_t {
+        float ms = 0.f;
+        bool from_cache = false;
+    };
+
+    inline build_stats_t last_build;
+
+    constexpr uint32_t file_magic = 0x4346414B; // "KAFC"
+    constexpr uint32_t file_version = 2;
+
+    struct file_header_t {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        int32_t width;
+        int32_t height;
+        int32_t font_count;
+        ImVec2 uv_white;
+        ImVec4 uv_lines[ IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1 ];
+    };
+
+    struct file_font_t {
+        float size;
+        float ascent;
+        float descent;
+        uint32_t fallback_char;
+        uint32_t ellipsis_char;
+        int32_t glyph_count;
+    };
+
+    class c_mapped_file {
+    public:
+        c_mapped_file( const std::string& path ) {
+#ifdef _WIN32
+            file = CreateFileA( path.c_str( ), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+            if ( file == INVALID_HANDLE_VALUE )
+                return;
+
+            LARGE_INTEGER file_size;
+            if ( !GetFileSizeEx( file, &file_size ) || file_size.QuadPart == 0 )
+                return;
+
+            mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+            if ( !mapping )
+                return;
+
+            data = ( const unsigned char* )MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+            if ( data )
+                size = ( size_t )file_size.QuadPart;
+#else
+            fd = open( path.c_str( ), O_RDONLY );
+            if ( fd < 0 )
+                return;
+
+            struct stat st;
+            if ( fstat( fd, &st ) != 0 || st.st_size == 0 )
+                return;
+
+            void* view = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            if ( view == MAP_FAILED )
+                return;
+
+            data = ( const unsigned char* )view;
+            size = ( size_t )st.st_size;
+#endif
+        }
+
+        ~c_mapped_file( ) {
+#ifdef _WIN32
+            if ( data ) UnmapViewOfFile( data );
+            if ( mapping ) CloseHandle( mapping );
+            if ( file != INVALID_HANDLE_VALUE ) CloseHandle( file );
+#else
+            if ( data ) munmap( ( void* )data, size );
+            if ( fd >= 0 ) close( fd );
+#endif
+        }
+
+        c_mapped_file( const c_mapped_file& ) = delete;
+        c_mapped_file& operator=( const c_mapped_file& ) = delete;
+
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+
+    private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int fd = -1;
+#endif
+    };
+
+    inline uint64_t fnv1a( uint64_t hash, const void* data, size_t size ) {
+        auto bytes = ( const unsigned char* )data;
+        for ( size_t i = 0; i < size; ++i )
+            hash = ( hash ^ bytes[i] ) * 1099511628211ULL;
+        return hash;
+    }
+
+    // Everything that changes the rasterized output: font path and file contents, per-config
+    // size/flags/ranges. The bytes are hashed rather than trusted by path, so a TTF replaced
+    // in place never loads the old glyphs.
+    inline uint64_t make_key( ImFontAtlas* atlas, const std::string& font_path ) {
+        uint64_t key = fnv1a( 1469598103934665603ULL, font_path.data( ), font_path.size( ) );
+
+        const int imgui_version = IMGUI_VERSION_NUM;
+        key = fnv1a( key, &imgui_version, sizeof( imgui_version ) );
+        key = fnv1a( key, &atlas->Flags, sizeof( atlas->Flags ) );
+        key = fnv1a( key, &atlas->TexGlyphPadding, sizeof( atlas->TexGlyphPadding ) );
+
+        for ( const auto& cfg : atlas->ConfigData ) {
+            key = fnv1a( key, &cfg.FontDataSize, sizeof( cfg.FontDataSize ) );
+            if ( cfg.FontData && cfg.FontDataSize > 0 )
+                key = fnv1a( key, cfg.FontData, ( size_t )cfg.FontDataSize );
+            key = fnv1a( key, &cfg.SizePixels, sizeof( cfg.SizePixels ) );
+            key = fnv1a( key, &cfg.OversampleH, sizeof( cfg.OversampleH ) );
+            key = fnv1a( key, &cfg.OversampleV, sizeof( cfg.OversampleV ) );
+            key = fnv1a( key, &cfg.PixelSnapH, sizeof( cfg.PixelSnapH ) );
+            key = fnv1a( key, &cfg.MergeMode, sizeof( cfg.MergeMode ) );
+            key = fnv1a( key, &cfg.FontBuilderFlags, sizeof( cfg.FontBuilderFlags ) );
+            key = fnv1a( key, &cfg.RasterizerMultiply, sizeof( cfg.RasterizerMultiply ) );
+
+            const ImWchar* ranges = cfg.GlyphRanges ? cfg.GlyphRanges : atlas->GetGlyphRangesDefault( );
+            for ( ; ranges[0]; ranges += 2 )
+                key = fnv1a( key, ranges, sizeof( ImWchar ) * 2 );
+        }
+
+        return key;
+    }
+
+    // <cache dir>/<app>/font_atlas.bin: %LOCALAPPDATA% on Windows, $XDG_CACHE_HOME or ~/.cache
+    // elsewhere. Without those (or if the directory cannot be created) the file goes next to
+    // the executable; an empty result disables the cache.
+    inline std::string default_path( const std::string& app ) {
+        namespace fs = std::filesystem;
+        std::error_code error;
+
+#ifdef _WIN32
+        const char* local = getenv( "LOCALAPPDATA" );
+        fs::path dir = local && *local ? fs::path( local ) : fs::path( );
+#else
+        const char* xdg = getenv( "XDG_CACHE_HOME" );
+        const char* home = getenv( "HOME" );
+        fs::path dir = xdg && *xdg ? fs::path( xdg ) : home && *home ? fs::path( home ) / ".cache" : fs::path( );
+#endif
+        if ( !dir.empty( ) ) {
+            dir /= app;
+            fs::create_directories( dir, error );
+            if ( !error )
+                return ( dir / "font_atlas.bin" ).string( );
+        }
+
+#ifdef _WIN32
+        wchar_t exe[MAX_PATH];
+        const DWORD length = GetModuleFileNameW( nullptr, exe, MAX_PATH );
+        if ( length == 0 || length == MAX_PATH )
+            return "";
+        return ( fs::path( exe ).parent_path( ) / "font_atlas.bin" ).string( );
+#else
+        char exe[PATH_MAX];
+        const ssize_t length = readlink( "/proc/self/exe", exe, sizeof( exe ) - 1 );
+        if ( length <= 0 )
+            return "";
+        exe[length] = 0;
+        return ( fs::path( exe ).parent_path( ) / "font_atlas.bin" ).string( );
+#endif
+    }
+
+    // Earlier versions kept one font_atlas_<key>.bin per key in the working directory
+    inline void remove_legacy_files( ) {
+        namespace fs = std::filesystem;
+        std::error_code error;
+        for ( fs::directory_iterator it( fs::current_path( error ), error ), end; !error && it != end; it.increment( error ) ) {
+            const std::string name = it->path( ).filename( ).string( );
+            if ( name.size( ) == 31 && name.compare( 0, 11, "font_atlas_" ) == 0 && name.compare( 27, 4, ".bin" ) == 0 ) {
+                std::error_code ignored;
+                fs::remove( it->path( ), ignored );
+            }
+        }
+    }
+
+    // Replaces the texture of an already populated atlas with an owned copy of alpha8 pixels
+    inline void set_texture( ImFontAtlas* atlas, const unsigned char* pixels, int width, int height, ImVec2 uv_white, const ImVec4* uv_lines ) {
+        atlas->ClearTexData( );
+        atlas->TexPixelsAlpha8 = ( unsigned char* )IM_ALLOC( ( size_t )width * height );
+        memcpy( atlas->TexPixelsAlpha8, pixels, ( size_t )width * height );
+        atlas->TexWidth = width;
+        atlas->TexHeight = height;
+        atlas->TexUvScale = ImVec2( 1.0f / width, 1.0f / height );
+        atlas->TexUvWhitePixel = uv_white;
+        for ( int n = 0; n <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; ++n )
+            atlas->TexUvLines[n] = uv_lines[n];
+        atlas->TexReady = true;
+    }
+
+    // Fills an existing ImFont in place so pointers held by the ui layer stay valid, and links
+    // it to its atlas and configs like ImFontAtlasBuildSetupFont; without that IsLoaded( ) is
+    // false and SetCurrentFont( ) dereferences a null ContainerAtlas
+    inline void set_font( ImFontAtlas* atlas, ImFont* font, const file_font_t& info, const ImFontGlyph* glyphs ) {
+        font->ContainerAtlas = atlas;
+        font->ConfigData = nullptr;
+        font->ConfigDataCount = 0;
+        for ( auto& cfg : atlas->ConfigData ) {
+            if ( cfg.DstFont != font )
+                continue;
+            if ( !font->ConfigData )
+                font->ConfigData = &cfg;
+            font->ConfigDataCount++;
+        }
+
+        font->FontSize = info.size;
+        font->Ascent = info.ascent;
+        font->Descent = info.descent;
+        font->FallbackChar = ( ImWchar )info.fallback_char;
+        font->EllipsisChar = ( ImWchar )info.ellipsis_char;
+        font->Glyphs.resize( info.glyph_count );
+        if ( info.glyph_count > 0 )
+            memcpy( font->Glyphs.Data, glyphs, sizeof( ImFontGlyph ) * info.glyph_count );
+        font->BuildLookupTable( );
+    }
+
+    inline bool load( ImFontAtlas* atlas, const std::string& path, uint64_t key ) {
+        c_mapped_file file( path );
+        if ( !file.data || file.size < sizeof( file_header_t ) )
+            return false;
+
+        file_header_t header;
+        memcpy( &header, file.data, sizeof( header ) );
+        if ( header.magic != file_magic || header.version != file_version || header.key != key || header.font_count != atlas->Fonts.Size )
+            return false;
+
+        // Validate the whole layout before touching the atlas
+        size_t offset = sizeof( header );
+        std::vector< std::pair< file_font_t, size_t > > fonts;
+        for ( int i = 0; i < header.font_count; ++i ) {
+            file_font_t info;
+            if ( file.size - offset < sizeof( info ) )
+                return false;
+            memcpy( &info, file.data + offset, sizeof( info ) );
+            offset += sizeof( info );
+
+            const size_t glyph_bytes = sizeof( ImFontGlyph ) * ( size_t )info.glyph_count;
+            if ( info.glyph_count < 0 || file.size - offset < glyph_bytes )
+                return false;
+            fonts.push_back( { info, offset } );
+            offset += glyph_bytes;
+        }
+
+        if ( header.width <= 0 || header.height <= 0 || file.size - offset != ( size_t )header.width * header.height )
+            return false;
+
+        // Every record is a multiple of 4 bytes, so glyph tables in the view are suitably aligned
+        for ( int i = 0; i < header.font_count; ++i )
+            set_font( atlas, atlas->Fonts[i], fonts[i].first, ( const ImFontGlyph* )( file.data + fonts[i].second ) );
+
+        set_texture( atlas, file.data + offset, header.width, header.height, header.uv_white, header.uv_lines );
+        return true;
+    }
+
+    inline bool save( ImFontAtlas* atlas, const std::string& path, uint64_t key ) {
+        if ( !atlas->TexPixelsAlpha8 )
+            return false;
+
+        file_header_t header = {};
+        header.magic = file_magic;
+        header.version = file_version;
+        header.key = key;
+        header.width = atlas->TexWidth;
+        header.height = atlas->TexHeight;
+        header.font_count = atlas->Fonts.Size;
+        header.uv_white = atlas->TexUvWhitePixel;
+        for ( int n = 0; n <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; ++n )
+            header.uv_lines[n] = atlas->TexUvLines[n];
+
+        // Write to a temporary file first so a crash never leaves a truncated cache behind
+        const std::string temp_path = path + ".tmp";
+        FILE* file = fopen( temp_path.c_str( ), "wb" );
+        if ( !file )
+            return false;
+
+        bool ok = fwrite( &header, sizeof( header ), 1, file ) == 1;
+        for ( int i = 0; ok && i < atlas->Fonts.Size; ++i ) {
+            const ImFont* font = atlas->Fonts[i];
+            file_font_t info = { font->FontSize, font->Ascent, font->Descent, ( uint32_t )font->FallbackChar, ( uint32_t )font->EllipsisChar, font->Glyphs.Size };
+            ok = fwrite( &info, sizeof( info ), 1, file ) == 1;
+            if ( ok && font->Glyphs.Size > 0 )
+                ok = fwrite( font->Glyphs.Data, sizeof( ImFontGlyph ), font->Glyphs.Size, file ) == ( size_t )font->Glyphs.Size;
+        }
+        if ( ok )
+            ok = fwrite( atlas->TexPixelsAlpha8, ( size_t )atlas->TexWidth * atlas->TexHeight, 1, file ) == 1;
+        ok = fclose( file ) == 0 && ok;
+
+        if ( ok ) {
+            std::remove( path.c_str( ) );
+            ok = std::rename( temp_path.c_str( ), path.c_str( ) ) == 0;
+        }
+        if ( !ok )
+            std::remove( temp_path.c_str( ) );
+        return ok;
+    }
+
+    // Rasterizes every font of the atlas concurrently, one private atlas per font (including
+    // its merged configs), then stacks the textures vertically and remaps glyph UVs.
+    inline bool build_parallel( ImFontAtlas* atlas ) {
+        struct job_t {
+            ImFont* target;
+            ImFontAtlas atlas;
+        };
+
+        std::vector< std::unique_ptr< job_t > > jobs;
+        for ( auto& cfg : atlas->ConfigData ) {
+            if ( !cfg.MergeMode || jobs.empty( ) ) {
+                auto job = std::make_unique< job_t >( );
+                job->target = cfg.DstFont;
+                job->atlas.Flags = atlas->Flags;
+                job->atlas.TexDesiredWidth = atlas->TexDesiredWidth;
+                job->atlas.TexGlyphPadding = atlas->TexGlyphPadding;
+                jobs.push_back( std::move( job ) );
+            }
+
+            ImFontConfig copy = cfg;
+            copy.FontDataOwnedByAtlas = false;
+            copy.DstFont = nullptr;
+            jobs.back( )->atlas.AddFont( &copy );
+        }
+
+        if ( jobs.empty( ) )
+            return ImGuiFreeType::BuildFontAtlas( atlas );
+
+        std::vector< std::future< bool > > results;
+        for ( auto& job : jobs ) {
+            ImFontAtlas* sub = &job->atlas;
+            results.push_back( std::async( std::launch::async, [sub]( ) {
+                KEYAUTH_TRACE_SCOPE( "font_cache::rasterize" );
+                return ImGuiFreeType::BuildFontAtlas( sub );
+            } ) );
+        }
+
+        bool ok = true;
+        for ( auto& result : results )
+            ok = result.get( ) && ok;
+        if ( !ok )
+            return false;
+
+        int width = 0, height = 0;
+        for ( auto& job : jobs ) {
+            width = ImMax( width, job->atlas.TexWidth );
+            height += job->atlas.TexHeight;
+        }
+
+        std::vector< unsigned char > pixels( ( size_t )width * height, 0 );
+        int y = 0;
+        for ( auto& job : jobs ) {
+            const ImFontAtlas& sub = job->atlas;
+            for ( int row = 0; row < sub.TexHeight; ++row )
+                memcpy( &pixels[( size_t )( y + row ) * width], &sub.TexPixelsAlpha8[( size_t )row * sub.TexWidth], sub.TexWidth );
+
+            const float su = ( float )sub.TexWidth / width;
+            const float sv = ( float )sub.TexHeight / height;
+            const float ov = ( float )y / height;
+
+            const ImFont* built = sub.Fonts[0];
+            file_font_t info = { built->FontSize, built->Ascent, built->Descent, ( uint32_t )built->FallbackChar, ( uint32_t )built->EllipsisChar, built->Glyphs.Size };
+            std::vector< ImFontGlyph > glyphs( built->Glyphs.begin( ), built->Glyphs.end( ) );
+            for ( auto& glyph : glyphs ) {
+                glyph.U0 *= su; glyph.U1 *= su;
+                glyph.V0 = glyph.V0 * sv + ov; glyph.V1 = glyph.V1 * sv + ov;
+            }
+            set_font( atlas, job->target, info, glyphs.data( ) );
+
+            y += sub.TexHeight;
+        }
+
+        // White pixel and line textures come from the first sub-atlas, which sits at the top
+        const ImFontAtlas& first = jobs.front( )->atlas;
+        const float su = ( float )first.TexWidth / width;
+        const float sv = ( float )first.TexHeight / height;
+        ImVec4 uv_lines[ IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1 ];
+        for ( int n = 0; n <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; ++n ) {
+            const ImVec4& uv = first.TexUvLines[n];
+            uv_lines[n] = ImVec4( uv.x * su, uv.y * sv, uv.z * su, uv.w * sv );
+        }
+
+        set_texture( atlas, pixels.data( ), width, height, ImVec2( first.TexUvWhitePixel.x * su, first.TexUvWhitePixel.y * sv ), uv_lines );
+        return true;
+    }
+
+    // Drop-in replacement for ImGuiFreeType::BuildFontAtlas: warm builds come from the cache
+    // file at path (see default_path); an empty path always rasterizes
+    inline bool build( ImFontAtlas* atlas, const std::string& font_path, const std::string& path ) {
+        KEYAUTH_TRACE_SCOPE( "font_cache::build" );
+        const auto start = std::chrono::steady_clock::now( );
+        const uint64_t key = make_key( atlas, font_path );
+
+        last_build.from_cache = !path.empty( ) && load( atlas, path, key );
+        bool ok = last_build.from_cache;
+        if ( !ok ) {
+            ok = build_parallel( atlas );
+            if ( ok && !path.empty( ) )
+                save( atlas, path, key );
+        }
+
+        last_build.ms = std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+        return ok;
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include "imgui/imgui.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <atomic>
+
+// Null ImGui backend: runs NewFrame/Render without a window or GPU and consumes the draw data
+// by counting it, so c_main::render can be profiled on Linux/CI. Pair with c_main as
+//
+//     c_headless headless( { 800, 600 } );
+//     main.initialize( ImGui::GetIO( ) ); headless.build_fonts( );
+//     for ( ... ) { c_headless_frame frame( headless ); main.render( ); }
+//     headless.get_totals( );
+namespace headless {
+    // ImGui routes every allocation through these, so the counts cover the whole frame
+    inline std::atomic< unsigned long long > allocations{ 0 };
+    inline std::atomic< unsigned long long > allocated_bytes{ 0 };
+
+    inline void* counting_alloc( size_t size, void* ) {
+        allocations++;
+        allocated_bytes += size;
+        return malloc( size );
+    }
+
+    inline void counting_free( void* ptr, void* ) {
+        free( ptr );
+    }
+}
+
+class c_headless {
+public:
+    struct frame_stats_t {
+        double cpu_ms = 0.0;
+        int vertices = 0;
+        int indices = 0;
+        int draw_calls = 0;
+        unsigned long long allocations = 0;
+        unsigned long long allocated_bytes = 0;
+    };
+
+    struct totals_t {
+        int frames = 0;
+        frame_stats_t sum;
+        frame_stats_t worst;
+    };
+
+    c_headless( ImVec2 display_size, float delta_time = 1.0f / 60.0f ) : delta_time( delta_time ) {
+        ImGui::SetAllocatorFunctions( headless::counting_alloc, headless::counting_free );
+        ImGui::CreateContext( );
+
+        auto& io = ImGui::GetIO( );
+        io.DisplaySize = display_size;
+        io.DeltaTime = delta_time;
+        io.IniFilename = nullptr;
+        io.LogFilename = nullptr;
+        io.BackendPlatformName = "imgui_impl_null";
+        io.BackendRendererName = "imgui_impl_null";
+        io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
+    }
+
+    ~c_headless( ) {
+        ImGui::DestroyContext( );
+    }
+
+    c_headless( const c_headless& ) = delete;
+    c_headless& operator=( const c_headless& ) = delete;
+
+    // Call after the fonts are added/built; stands in for uploading the atlas to a GPU texture
+    void build_fonts( ) {
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0;
+        ImGui::GetIO( ).Fonts->GetTexDataAsAlpha8( &pixels, &width, &height );
+        ImGui::GetIO( ).Fonts->SetTexID( ( ImTextureID )( intptr_t )1 );
+    }
+
+    // Input injection for scripted frames
+    void set_mouse( ImVec2 pos, bool down = false ) {
+        auto& io = ImGui::GetIO( );
+        io.AddMousePosEvent( pos.x, pos.y );
+        io.AddMouseButtonEvent( 0, down );
+    }
+
+    const frame_stats_t& get_last_frame( ) const { return last_frame; }
+    const totals_t& get_totals( ) const { return totals; }
+
+    void reset_totals( ) { totals = {}; }
+
+private:
+    friend class c_headless_frame;
+
+    float delta_time;
+    frame_stats_t last_frame;
+    totals_t totals;
+
+    std::chrono::steady_clock::time_point frame_start;
+    unsigned long long frame_allocations = 0;
+    unsigned long long frame_bytes = 0;
+
+    void begin( ) {
+        frame_allocations = headless::allocations;
+        frame_bytes = headless::allocated_bytes;
+        frame_start = std::chrono::steady_clock::now( );
+
+        ImGui::GetIO( ).DeltaTime = delta_time;
+        ImGui::NewFrame( );
+    }
+
+    void end( ) {
+        ImGui::Render( );
+
+        frame_stats_t stats;
+        stats.cpu_ms = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now( ) - frame_start ).count( );
+
+        // "Render" the draw data: walk it the way a GPU backend would and count it
+        if ( ImDrawData* draw_data = ImGui::GetDrawData( ) ) {
+            stats.vertices = draw_data->TotalVtxCount;
+            stats.indices = draw_data->TotalIdxCount;
+            for ( int n = 0; n < draw_data->CmdListsCount; ++n )
+                stats.draw_calls += draw_data->CmdLists[n]->CmdBuffer.Size;
+        }
+
+        stats.allocations = headless::allocations - frame_allocations;
+        stats.allocated_bytes = headless::allocated_bytes - frame_bytes;
+
+        last_frame = stats;
+        totals.frames++;
+        totals.sum.cpu_ms += stats.cpu_ms;
+        totals.sum.vertices += stats.vertices;
+        totals.sum.indices += stats.indices;
+        totals.sum.draw_calls += stats.draw_calls;
+        totals.sum.allocations += stats.allocations;
+        totals.sum.allocated_bytes += stats.allocated_bytes;
+        if ( stats.cpu_ms > totals.worst.cpu_ms ) totals.worst = stats;
+    }
+};
+
+// Same scope-based shape as c_frame: NewFrame on construction, Render + draw data on destruction
+class c_headless_frame {
+public:
+    c_headless_frame( c_headless& owner ) : owner( owner ) {
+        owner.begin( );
+    }
+
+    ~c_headless_frame( ) {
+        owner.end( );
+    }
+
+private:
+    c_headless& owner;
+};
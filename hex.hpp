@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+// Lowercase hex for the binary values kept in text form: TLS tickets in tls.cache, Ed25519 keys
+// and signatures, \u escapes in JSON. Decoding accepts either case.
+namespace hex {
+    inline constexpr char digits[] = "0123456789abcdef";
+
+    // Value of one hex digit, or -1
+    inline int nibble(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    inline std::string encode(const unsigned char* data, size_t size) {
+        std::string text;
+        text.reserve(size * 2);
+        for (size_t i = 0; i < size; ++i) {
+            text += digits[data[i] >> 4];
+            text += digits[data[i] & 0x0F];
+        }
+        return text;
+    }
+
+    // Exactly size bytes; fails on any other length or a non-hex digit
+    inline bool decode(std::string_view text, unsigned char* out, size_t size) {
+        if (text.size() != size * 2) return false;
+
+        for (size_t i = 0; i < size; ++i) {
+            int high = nibble(text[i * 2]);
+            int low = nibble(text[i * 2 + 1]);
+            if (high < 0 || low < 0) return false;
+            out[i] = (unsigned char)(high << 4 | low);
+        }
+        return true;
+    }
+
+    inline bool decode(std::string_view text, std::vector<unsigned char>& out) {
+        if (text.size() % 2) return false;
+        out.resize(text.size() / 2);
+        return decode(text, out.data(), out.size());
+    }
+}
@@ -0,0 +1,346 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include "trace.hpp"
+#include "secure_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <filesystem>
+#endif
+
+// Hardware fingerprint for HWID binding.
+//
+// collect() gathers stable machine identifiers ("source=value" lines): machine-id, DMI and
+// the serials of fixed disks and burned-in MACs of onboard NICs from sysfs on Linux,
+// MachineGuid, the system volume serial and the MACs of PCI network adapters on Windows.
+// Removable disks, USB network dongles, randomized/software-assigned MACs and virtual
+// adapters (VPNs, Hyper-V, VM bridges) are left out, since they come and go. fingerprint()
+// sorts the lines and hashes them with FNV-1a, so the result doesn't depend on enumeration
+// order or on the standard library's std::hash.
+//
+// Walking sysfs/the registry is slow enough to notice at startup, so load_or_compute() keeps
+// the result on disk. The cache is bound to the anchor, the identifiers that are cheap to read
+// again on every start (machine id and DMI on Linux, MachineGuid and volume serial on
+// Windows): DPAPI with the anchor as entropy on Windows, a SipHash tag keyed by it elsewhere.
+// An edited cache, or one copied from another machine, is recomputed instead of trusted. The
+// key is derived from the machine itself, so this is no secret from the machine's own root.
+//
+// The 2.x fingerprint no longer includes removable and virtual devices, so it differs from the
+// one 1.x reported for the same machine; KAHW1 caches are ignored. Reset your users' HWIDs on
+// the KeyAuth dashboard (or let them request it) when shipping the upgrade.
+namespace hwid {
+    inline const char* const magic = "KAHW2";
+    
+    struct Timing {
+        double ms = 0.0;
+        bool from_cache = false;
+    };
+    
+    struct Result {
+        std::string id;
+        Timing timing;
+    };
+    
+    inline unsigned long long fnv1a(const std::string& data, unsigned long long hash = 1469598103934665603ULL) {
+        for (unsigned char c : data) hash = (hash ^ c) * 1099511628211ULL;
+        return hash;
+    }
+    
+    inline std::string trim(std::string value) {
+        while (!value.empty() && isspace((unsigned char)value.back())) value.pop_back();
+        size_t start = 0;
+        while (start < value.size() && isspace((unsigned char)value[start])) ++start;
+        return value.substr(start);
+    }
+    
+    // SipHash-2-4, a keyed MAC that is short enough to carry here
+    inline unsigned long long siphash(unsigned long long k0, unsigned long long k1, const std::string& data) {
+        unsigned long long v0 = 0x736f6d6570736575ULL ^ k0, v1 = 0x646f72616e646f6dULL ^ k1;
+        unsigned long long v2 = 0x6c7967656e657261ULL ^ k0, v3 = 0x7465646279746573ULL ^ k1;
+        auto rotl = [](unsigned long long x, int bits) { return (x << bits) | (x >> (64 - bits)); };
+        auto round = [&] {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        };
+        auto absorb = [&](unsigned long long m) {
+            v3 ^= m;
+            round();
+            round();
+            v0 ^= m;
+        };
+        
+        const size_t tail = data.size() & ~(size_t)7;
+        for (size_t i = 0; i < tail; i += 8) {
+            unsigned long long m = 0;
+            for (int b = 0; b < 8; ++b) m |= (unsigned long long)(unsigned char)data[i + b] << (8 * b);
+            absorb(m);
+        }
+        unsigned long long last = (unsigned long long)(data.size() & 0xFF) << 56;
+        for (size_t i = tail; i < data.size(); ++i) last |= (unsigned long long)(unsigned char)data[i] << (8 * (i - tail));
+        absorb(last);
+        
+        v2 ^= 0xFF;
+        for (int i = 0; i < 4; ++i) round();
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+#ifdef _WIN32
+    inline std::string machine_key() {
+        HKEY key = nullptr;
+        if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, "SOFTWARE\\Microsoft\\Cryptography", 0, KEY_READ | KEY_WOW64_64KEY, &key) != ERROR_SUCCESS) {
+            return "";
+        }
+        
+        char buffer[128] = {};
+        DWORD size = sizeof(buffer) - 1;
+        LONG status = RegQueryValueExA(key, "MachineGuid", nullptr, nullptr, (LPBYTE)buffer, &size);
+        RegCloseKey(key);
+        return status == ERROR_SUCCESS ? trim(buffer) : "";
+    }
+    
+    // Interface GUIDs (IP_ADAPTER_ADDRESSES::AdapterName) of network adapters that are physical
+    // and sit on the PCI bus. Virtual adapters (Hyper-V, VMware/VirtualBox bridges, VPNs) are
+    // software-enumerated and USB dongles are not on PCI, so neither is listed.
+    inline std::vector<std::string> pci_adapters() {
+        const DWORD ncf_virtual = 0x1, ncf_physical = 0x4; // netcfgx.h
+        std::vector<std::string> guids;
+        
+        HKEY adapters = nullptr;
+        if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, "SYSTEM\\CurrentControlSet\\Control\\Class\\{4d36e972-e325-11ce-bfc1-08002be10318}",
+                          0, KEY_READ, &adapters) != ERROR_SUCCESS) {
+            return guids;
+        }
+        
+        char name[256];
+        for (DWORD index = 0;; ++index) {
+            DWORD name_size = sizeof(name);
+            if (RegEnumKeyExA(adapters, index, name, &name_size, nullptr, nullptr, nullptr, nullptr) != ERROR_SUCCESS) break;
+            
+            char component[256] = {}, guid[64] = {};
+            DWORD characteristics = 0;
+            DWORD component_size = sizeof(component), guid_size = sizeof(guid), characteristics_size = sizeof(characteristics);
+            if (RegGetValueA(adapters, name, "ComponentId", RRF_RT_REG_SZ, nullptr, component, &component_size) != ERROR_SUCCESS ||
+                RegGetValueA(adapters, name, "NetCfgInstanceId", RRF_RT_REG_SZ, nullptr, guid, &guid_size) != ERROR_SUCCESS ||
+                RegGetValueA(adapters, name, "Characteristics", RRF_RT_REG_DWORD, nullptr, &characteristics, &characteristics_size) != ERROR_SUCCESS) {
+                continue;
+            }
+            
+            if ((characteristics & ncf_physical) && !(characteristics & ncf_virtual) && _strnicmp(component, "pci\\", 4) == 0) {
+                guids.push_back(guid);
+            }
+        }
+        
+        RegCloseKey(adapters);
+        return guids;
+    }
+    
+    // Cheap enough to read on every start
+    inline std::vector<std::string> anchor_parts() {
+        std::vector<std::string> parts;
+        
+        std::string guid = machine_key();
+        if (!guid.empty()) parts.push_back("machine-guid=" + guid);
+        
+        char windows_dir[MAX_PATH] = {};
+        if (GetSystemWindowsDirectoryA(windows_dir, MAX_PATH) >= 3) {
+            char root[4] = { windows_dir[0], ':', '\\', 0 };
+            DWORD serial = 0;
+            if (GetVolumeInformationA(root, nullptr, 0, &serial, nullptr, nullptr, nullptr, 0)) {
+                parts.push_back("volume=" + std::to_string(serial));
+            }
+        }
+        
+        return parts;
+    }
+    
+    inline std::vector<std::string> collect() {
+        std::vector<std::string> parts = anchor_parts();
+        const std::vector<std::string> pci = pci_adapters();
+        
+        ULONG size = 16 * 1024;
+        std::vector<unsigned char> buffer(size);
+        ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER | GAA_FLAG_SKIP_UNICAST;
+        if (GetAdaptersAddresses(AF_UNSPEC, flags, nullptr, (PIP_ADAPTER_ADDRESSES)buffer.data(), &size) == ERROR_BUFFER_OVERFLOW) {
+            buffer.resize(size);
+        }
+        if (GetAdaptersAddresses(AF_UNSPEC, flags, nullptr, (PIP_ADAPTER_ADDRESSES)buffer.data(), &size) == NO_ERROR) {
+            for (auto adapter = (PIP_ADAPTER_ADDRESSES)buffer.data(); adapter; adapter = adapter->Next) {
+                // Physical NICs only; VPN/loopback/tunnel and virtual Ethernet adapters come and go
+                if (adapter->IfType != IF_TYPE_ETHERNET_CSMACD && adapter->IfType != IF_TYPE_IEEE80211) continue;
+                if (adapter->PhysicalAddressLength != 6) continue;
+                if (std::find(pci.begin(), pci.end(), adapter->AdapterName) == pci.end()) continue;
+                
+                char mac[18];
+                const BYTE* a = adapter->PhysicalAddress;
+                snprintf(mac, sizeof(mac), "%02x:%02x:%02x:%02x:%02x:%02x", a[0], a[1], a[2], a[3], a[4], a[5]);
+                parts.push_back(std::string("mac=") + mac);
+            }
+        }
+        
+        return parts;
+    }
+#else
+    inline std::string read_line(const std::string& path) {
+        std::ifstream file(path);
+        std::string line;
+        if (!file || !std::getline(file, line)) return "";
+        return trim(line);
+    }
+    
+    inline std::string machine_key() {
+        std::string id = read_line("/etc/machine-id");
+        return id.empty() ? read_line("/var/lib/dbus/machine-id") : id;
+    }
+    
+    // Cheap enough to read on every start
+    inline std::vector<std::string> anchor_parts() {
+        std::vector<std::string> parts;
+        
+        std::string id = machine_key();
+        if (!id.empty()) parts.push_back("machine-id=" + id);
+        
+        // The uuid/serial files are root-only on most distributions; whatever is readable is used
+        static const char* const dmi_fields[] = {
+            "product_uuid", "product_serial", "board_serial", "chassis_serial",
+            "sys_vendor", "product_name", "board_vendor", "board_name"
+        };
+        for (const char* field : dmi_fields) {
+            std::string value = read_line(std::string("/sys/class/dmi/id/") + field);
+            if (!value.empty()) parts.push_back(std::string("dmi.") + field + "=" + value);
+        }
+        
+        return parts;
+    }
+    
+    // Devices behind a USB bridge can be unplugged even when they don't report as removable
+    inline bool on_usb(const std::filesystem::path& device) {
+        std::error_code ec;
+        return std::filesystem::canonical(device, ec).string().find("/usb") != std::string::npos;
+    }
+    
+    inline std::vector<std::string> collect() {
+        namespace fs = std::filesystem;
+        std::vector<std::string> parts = anchor_parts();
+        std::error_code ec;
+        
+        // Interfaces without a backing device (lo, bridges, veth, tun) are virtual. Only burned-in
+        // addresses count (addr_assign_type 0): random, stolen and user-set ones can change.
+        for (const auto& entry : fs::directory_iterator("/sys/class/net", ec)) {
+            if (!fs::exists(entry.path() / "device", ec) || on_usb(entry.path() / "device")) continue;
+            if (read_line((entry.path() / "addr_assign_type").string()) != "0") continue;
+            
+            std::string mac = read_line((entry.path() / "address").string());
+            if (!mac.empty() && mac != "00:00:00:00:00:00") parts.push_back("mac=" + mac);
+        }
+        
+        for (const auto& entry : fs::directory_iterator("/sys/block", ec)) {
+            const std::string name = entry.path().filename().string();
+            if (name.rfind("loop", 0) == 0 || name.rfind("ram", 0) == 0 || name.rfind("zram", 0) == 0 || name.rfind("dm-", 0) == 0) continue;
+            if (read_line((entry.path() / "removable").string()) != "0" || on_usb(entry.path())) continue;
+            
+            for (const char* field : {"serial", "wwid"}) {
+                std::string value = read_line((entry.path() / "device" / field).string());
+                if (!value.empty()) parts.push_back("disk." + name + "." + field + "=" + value);
+            }
+        }
+        
+        return parts;
+    }
+#endif
+    
+    inline std::string fingerprint(std::vector<std::string> parts) {
+        std::sort(parts.begin(), parts.end());
+        
+        // Two differently seeded lanes for a 128-bit id
+        unsigned long long low = 1469598103934665603ULL;
+        unsigned long long high = 0x9E3779B97F4A7C15ULL;
+        for (const auto& part : parts) {
+            low = fnv1a(part + "\n", low);
+            high = fnv1a(part + "\n", high);
+        }
+        
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "HWID-%016llX%016llX", high, low);
+        return buffer;
+    }
+    
+    // The cache file's contents: plain text bound to the anchor, see above
+#ifdef _WIN32
+    inline bool seal(const std::string& plain, const std::string& anchor, std::string& out) {
+        return secure_file::protect(plain, anchor, L"KeyAuth HWID", out);
+    }
+    
+    inline bool unseal(const std::string& blob, const std::string& anchor, std::string& out) {
+        return secure_file::unprotect(blob, anchor, out);
+    }
+#else
+    inline std::string tag(const std::string& plain, const std::string& anchor) {
+        char hex[17];
+        snprintf(hex, sizeof(hex), "%016llx", siphash(fnv1a(anchor), fnv1a(anchor, 0x9E3779B97F4A7C15ULL), plain));
+        return hex;
+    }
+    
+    // The tag goes on its own last line
+    inline bool seal(const std::string& plain, const std::string& anchor, std::string& out) {
+        out = plain + tag(plain, anchor) + "\n";
+        return true;
+    }
+    
+    inline bool unseal(const std::string& blob, const std::string& anchor, std::string& out) {
+        if (blob.size() < 17 || blob.back() != '\n') return false;
+        out = blob.substr(0, blob.size() - 17);
+        return blob.compare(blob.size() - 17, 16, tag(out, anchor)) == 0;
+    }
+#endif
+    
+    // Cached fingerprint if it was sealed on this machine (same anchor), otherwise a fresh
+    // one which is written back for next time. An empty path disables the cache.
+    inline Result load_or_compute(const std::string& cache_path) {
+        KEYAUTH_TRACE_SCOPE("hwid::load_or_compute");
+        const auto start = std::chrono::steady_clock::now();
+        auto elapsed_ms = [&] {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        
+        Result result;
+        std::string anchor;
+        for (const auto& part : anchor_parts()) anchor += part + "\n";
+        
+        if (!cache_path.empty() && !anchor.empty()) {
+            std::string blob, plain, header, cached_id;
+            std::istringstream lines;
+            if (secure_file::read(cache_path, blob) && unseal(blob, anchor, plain)) lines.str(plain);
+            if (std::getline(lines, header) && header == magic && std::getline(lines, cached_id) && !cached_id.empty()) {
+                result.id = cached_id;
+                result.timing = { elapsed_ms(), true };
+                return result;
+            }
+        }
+        
+        std::vector<std::string> parts = collect();
+        if (parts.empty()) parts.push_back("unknown");
+        result.id = fingerprint(std::move(parts));
+        
+        std::string blob;
+        if (!cache_path.empty() && !anchor.empty() && seal(std::string(magic) + "\n" + result.id + "\n", anchor, blob)) {
+            secure_file::write_private(cache_path, blob);
+        }
+        
+        result.timing = { elapsed_ms(), false };
+        return result;
+    }
+}
\ No newline at end of file
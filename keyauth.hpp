@@ -2,33 +2,287 @@
 #include <string>
 #include <iostream>
 #include <vector>
-#include <map>
 #include <curl/curl.h>
-#include <json/json.h>
 #include <ctime>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include "decoder.hpp"
+#include "request.hpp"
+#include "hwid.hpp"
+#include "license_token.hpp"
+#include "request_metrics.hpp"
+#include "trace.hpp"
+#include "tls_cache.hpp"
+#include "transport.hpp"
+#include "published.hpp"
 
+#ifdef _MSC_VER
 #pragma comment(lib, "libcurl.lib")
+#endif
 
 class KeyAuth {
+public:
+    struct Subscription {
+        std::string name;
+        std::string key;
+        time_t expiry = 0;
+        long long timeleft = 0; // seconds left when the response was received
+    };
+    
+    struct UserInfo {
+        std::string username;
+        std::string ip;
+        std::string hwid;
+        time_t created = 0;
+        time_t last_login = 0;
+        std::vector<Subscription> subscriptions;
+        
+        // Latest expiry across all subscriptions; 0 if there are none
+        time_t expiry() const {
+            time_t latest = 0;
+            for (const auto& sub : subscriptions) latest = std::max(latest, sub.expiry);
+            return latest;
+        }
+    };
+    
+    // Every endpoint answers {success, message, ...}; T is whatever else it carries
+    template<class T>
+    struct Result {
+        bool success = false;
+        std::string message;
+        T value{};
+    };
+    
+    using AuthResult = Result<UserInfo>;
+    
+    // Immutable copy of all client state. Every change publishes a new one (copy-on-write),
+    // so a reader always sees a consistent set of fields. Handed out by session() as a
+    // shared_ptr that keeps it alive while the reader holds it.
+    struct SessionSnapshot {
+        enum class State { logged_out, active, expired, invalidated };
+        
+        unsigned long long version = 0; // increases with every publish
+        State state = State::logged_out;
+        bool initialized = false;
+        std::string session_id;
+        UserInfo user;
+        time_t expiry = 0;       // user.expiry(), computed once
+        std::string reason;      // why the session ended, for expired/invalidated
+        std::string last_error;  // why the last init()/check() failed
+        license_token::Token token; // signed login response, for offline validation
+        
+        bool active() const {
+            return state == State::active;
+        }
+    };
+
 private:
     std::string app_name;
     std::string app_secret;
     std::string app_version;
-    std::string api_url = "https://keyauth.win/api/1.2/";
+    std::string api_url;
+    std::string ca_bundle; // empty = system trust store
+    
+    std::shared_future<hwid::Result> hwid_result;
+    
+    // Concurrency model: the configuration above is fixed at construction, and everything
+    // that changes (init/login state, session id, user info) lives in the SessionSnapshot
+    // published below. Writers copy the current snapshot, edit the copy and publish it
+    // under state_mutex; readers load it lock-free. See session() for the guarantees.
+    mutable std::mutex state_mutex;
+    
+    // Upper bound for trusting a server-supplied Content-Length when pre-sizing buffers
+    static constexpr size_t max_reserve = 1 << 20;
+    
+    using clock = std::chrono::steady_clock;
     
-    std::string session_id;
-    std::string username;
-    std::string subscription;
-    std::string expiry;
-    std::string hwid;
+    // Body, status, libcurl result and signature headers come from transport::Response
+    struct APIResponse : transport::Response {
+        bool rejected = false; // failed fast by the circuit breaker or the rate limiter, never sent
+        bool throttled = false; // rejected by the rate limiter
+        clock::duration elapsed{};
+    };
+
+public:
+    // Budgets for one logical call. Only idempotent requests (init, check) are retried or
+    // hedged; login, register and license are sent exactly once.
+    struct CallPolicy {
+        std::chrono::milliseconds deadline{10000};      // total budget across all attempts
+        int max_attempts = 3;
+        std::chrono::milliseconds backoff_base{200};    // full jitter: wait U(0, base * 2^n)
+        std::chrono::milliseconds backoff_max{2000};
+        bool hedge = false;                             // race a second copy after the p95 latency
+        int breaker_threshold = 5;                      // consecutive failures that open the breaker
+        std::chrono::milliseconds breaker_cooldown{5000};
+        double rate_per_second = 1.0;                   // sustained calls per endpoint; 0 disables the limiter
+        double rate_burst = 10.0;                       // calls per endpoint that may go out back to back
+    };
     
-    bool initialized = false;
-    bool logged_in = false;
+    struct CallStats {
+        unsigned long retries = 0;
+        unsigned long hedges = 0;
+        unsigned long hedge_wins = 0;
+        unsigned long rejected = 0;
+        unsigned long timeouts = 0;
+        unsigned long coalesced = 0; // answered by an identical call already in flight
+        unsigned long throttled = 0; // refused by the per-endpoint rate limiter
+        bool circuit_open = false;
+    };
     
-    struct APIResponse {
-        std::string data;
-        long response_code;
+    enum class TransportMode {
+        compatible, // HTTP/1.1, uncompressed bodies
+        optimized   // HTTP/2 when the server offers it over ALPN, gzip/brotli/zstd bodies
     };
+
+private:
+    CallPolicy call_policy;
+    mutable std::mutex policy_mutex;
+    
+    std::atomic<unsigned long> retries{0};
+    std::atomic<unsigned long> hedges{0};
+    std::atomic<unsigned long> hedge_wins{0};
+    std::atomic<unsigned long> rejected_calls{0};
+    std::atomic<unsigned long> timeouts{0};
+    std::atomic<unsigned long> coalesced_calls{0};
+    std::atomic<unsigned long> throttled_calls{0};
+    
+    // Closed: requests go through. Open: requests fail immediately without touching the
+    // network while a background probe waits out the cooldown. Half-open: the probe is in
+    // flight; success closes the breaker, failure reopens it and schedules the next probe.
+    class CircuitBreaker {
+    public:
+        enum class State { closed, open, half_open };
+        
+        bool allow() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return state == State::closed;
+        }
+        
+        void record_success() {
+            std::lock_guard<std::mutex> lock(mutex);
+            state = State::closed;
+            failures = 0;
+        }
+        
+        // True when this failure opened the breaker, i.e. the caller should schedule a probe
+        bool record_failure(int threshold) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (state == State::open) return false;
+            if (state == State::closed && ++failures < threshold) return false;
+            
+            state = State::open;
+            failures = 0;
+            return true;
+        }
+        
+        bool begin_probe() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (state != State::open) return false;
+            state = State::half_open;
+            return true;
+        }
+        
+        State get_state() const {
+            std::lock_guard<std::mutex> lock(mutex);
+            return state;
+        }
+    
+    private:
+        mutable std::mutex mutex;
+        State state = State::closed;
+        int failures = 0;
+    };
+    
+    // Sustained rate with bursts, refilled lazily on each take()
+    class TokenBucket {
+    public:
+        bool take(double rate, double burst, clock::time_point now) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (last == clock::time_point()) tokens = burst;
+            else tokens = std::min(burst, tokens + std::chrono::duration<double>(now - last).count() * rate);
+            last = now;
+            
+            if (tokens < 1.0) return false;
+            tokens -= 1.0;
+            return true;
+        }
+    
+    private:
+        std::mutex mutex;
+        double tokens = 0.0;
+        clock::time_point last;
+    };
+    
+    CircuitBreaker breaker;
+    
+    // Recent successful round trips; their p95 is how long a hedged call waits before racing a copy
+    static constexpr size_t latency_window = 64;
+    static constexpr size_t min_hedge_samples = 16;
+    std::vector<clock::duration> latencies;
+    size_t latency_next = 0;
+    std::mutex latency_mutex;
+    
+    // DNS results and TLS sessions shared by every handle this client opens (the sync handle,
+    // the engine's pool, hedges, probes and heartbeats), so any new connection skips the lookup
+    // and resumes the TLS session. Connections themselves are not shared: libcurl does not
+    // support one connection cache used from several threads at once.
+    CURLSH* share = nullptr;
+    std::mutex share_locks[CURL_LOCK_DATA_LAST];
+    std::string tls_cache_path;
+    int tls_sessions_loaded = 0;
+    
+    // Replaces libcurl for every request when set; see transport.hpp
+    std::shared_ptr<transport::Transport> backend;
+    
+    static void lock_share(CURL*, curl_lock_data data, curl_lock_access, void* owner) {
+        ((KeyAuth*)owner)->share_locks[data].lock();
+    }
+    
+    static void unlock_share(CURL*, curl_lock_data data, void* owner) {
+        ((KeyAuth*)owner)->share_locks[data].unlock();
+    }
+    
+    // One easy handle per client so libcurl keeps the connection (and TLS session)
+    // alive between init/login/register calls instead of handshaking every time.
+    CURL* curl = nullptr;
+    mutable std::mutex request_mutex;
+    
+    // When a transfer last finished, for preconnect(); steady clock ticks
+    std::atomic<clock::rep> last_transfer_at{0};
+    std::atomic<unsigned long> preconnects{0};
+    
+    std::atomic<unsigned long> fresh_connections{0};
+    std::atomic<unsigned long> reused_connections{0};
+    std::atomic<unsigned long> http2_transfers{0};
+    std::atomic<unsigned long long> bytes_sent{0};
+    std::atomic<unsigned long long> bytes_received{0};
+    
+    // Indexed by endpoint_index(); the last slot catches anything unrecognised
+    static constexpr const char* metric_endpoints[] = {
+        request::Init::type, request::Login::type, request::Register::type, request::License::type, request::Check::type, "other"
+    };
+    static constexpr size_t metric_endpoint_count = std::size(metric_endpoints);
+    request_metrics::Endpoint endpoint_metrics[metric_endpoint_count] = {
+        request_metrics::Endpoint(metric_endpoints[0]), request_metrics::Endpoint(metric_endpoints[1]),
+        request_metrics::Endpoint(metric_endpoints[2]), request_metrics::Endpoint(metric_endpoints[3]),
+        request_metrics::Endpoint(metric_endpoints[4]), request_metrics::Endpoint(metric_endpoints[5])
+    };
+    
+    // A server or middlebox that breaks HTTP/2 or content decoding drops the client back to
+    // compatible mode for the rest of its lifetime; set_transport_mode() clears it
+    std::atomic<TransportMode> transport_mode{TransportMode::optimized};
+    std::atomic<bool> transport_fallback{false};
+    std::atomic<unsigned long> transport_fallbacks{0};
     
     static size_t WriteCallback(void* contents, size_t size, size_t nmemb, APIResponse* response) {
         size_t total_size = size * nmemb;
@@ -36,267 +290,1449 @@ private:
         return total_size;
     }
     
-    APIResponse make_request(const std::string& endpoint, const std::map<std::string, std::string>& data) {
-        CURL* curl;
-        CURLcode res;
-        APIResponse response;
+    // Case-insensitive match of a "name:" header line; value is trimmed
+    static bool header_value(const char* buffer, size_t size, const char* name, std::string& value) {
+        const size_t name_len = strlen(name);
+        if (size <= name_len || buffer[name_len] != ':') return false;
         
-        curl = curl_easy_init();
-        if (curl) {
-            std::string url = api_url + endpoint;
-            std::string post_data = "";
-            
-            for (auto const& pair : data) {
-                if (!post_data.empty()) post_data += "&";
-                post_data += pair.first + "=" + pair.second;
+        for (size_t i = 0; i < name_len; ++i) {
+            if ((char)tolower((unsigned char)buffer[i]) != name[i]) return false;
+        }
+        
+        size_t begin = name_len + 1;
+        size_t end = size;
+        while (begin < end && isspace((unsigned char)buffer[begin])) ++begin;
+        while (end > begin && isspace((unsigned char)buffer[end - 1])) --end;
+        value.assign(buffer + begin, end - begin);
+        return true;
+    }
+    
+    // Reserves the body buffer up front from Content-Length so WriteCallback rarely regrows it
+    // (for a compressed body that is the encoded size, so a lower bound), and keeps the
+    // signature headers for offline license tokens
+    static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, APIResponse* response) {
+        size_t total_size = size * nitems;
+        std::string value;
+        
+        if (header_value(buffer, total_size, "content-length", value)) {
+            size_t length = strtoul(value.c_str(), nullptr, 10);
+            if (length > 0 && length <= max_reserve) response->data.reserve(length);
+        } else if (header_value(buffer, total_size, "x-signature-ed25519", value)) {
+            response->signature = value;
+        } else if (header_value(buffer, total_size, "x-signature-timestamp", value)) {
+            response->signature_timestamp = value;
+        }
+        
+        return total_size;
+    }
+    
+    void setup_handle(CURL* handle) const {
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L);
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, "KeyAuth");
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT, 30L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+        // Resume TLS sessions (tickets on TLS 1.3) when a connection has to be reopened
+        curl_easy_setopt(handle, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+        if (share) curl_easy_setopt(handle, CURLOPT_SHARE, share);
+        if (!ca_bundle.empty()) curl_easy_setopt(handle, CURLOPT_CAINFO, ca_bundle.c_str());
+    }
+    
+    TransportMode effective_transport() const {
+        return transport_fallback ? TransportMode::compatible : transport_mode.load();
+    }
+    
+    // Set per transfer, so a fallback applies to pooled handles too. ALPN negotiation already
+    // lands on HTTP/1.1 for servers without HTTP/2, and an empty Accept-Encoding offers every
+    // encoding this libcurl can decode; the server is free to answer uncompressed. Returns the
+    // mode the transfer goes out in.
+    TransportMode apply_transport(CURL* handle) const {
+        const TransportMode mode = effective_transport();
+        if (mode == TransportMode::optimized) {
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+            curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+        } else {
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+            curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, nullptr);
+        }
+        return mode;
+    }
+    
+    // Failures that optimized mode can cause and compatible mode avoids. The first one switches
+    // the client to compatible mode for every later request and is the only one counted; every
+    // transfer that went out optimized and failed this way is eligible for a resend, including
+    // those in flight alongside the first. Returns true if the failed request should be resent
+    // now: always for idempotent ones, otherwise only if none of its body went out, since the
+    // server may already have acted on a login or registration (a bad content encoding is only
+    // noticed once the reply arrives). A transfer sent in compatible mode is never resent.
+    bool fall_back_transport(CURL* handle, CURLcode result, bool idempotent, TransportMode sent) {
+        if (result != CURLE_HTTP2 && result != CURLE_HTTP2_STREAM && result != CURLE_BAD_CONTENT_ENCODING) return false;
+        if (sent != TransportMode::optimized) return false;
+        
+        if (!transport_fallback.exchange(true)) transport_fallbacks++;
+        if (idempotent) return true;
+        
+        curl_off_t uploaded = 0;
+        curl_easy_getinfo(handle, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+        return uploaded == 0;
+    }
+    
+    // Bodies start with "type=<endpoint>&", see request::encode; probes and pre-connects send none
+    static size_t endpoint_index(const std::string& post_data) {
+        for (size_t i = 0; i + 1 < metric_endpoint_count; ++i) {
+            const size_t length = strlen(metric_endpoints[i]);
+            if (post_data.compare(0, 5, "type=") == 0 && post_data.compare(5, length, metric_endpoints[i]) == 0 &&
+                (post_data.size() == 5 + length || post_data[5 + length] == '&')) {
+                return i;
             }
+        }
+        return metric_endpoint_count - 1;
+    }
+    
+    // Called once per finished transfer, failed ones included. Only reads values libcurl has
+    // already measured, so it adds no syscalls and no locks to the request path.
+    void count_transfer(CURL* handle, CURLcode result, const std::string& post_data) {
+        last_transfer_at = clock::now().time_since_epoch().count();
+        
+        // NUM_CONNECTS is the number of new connections this transfer had to open
+        long new_connections = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &new_connections);
+        
+        // Body sizes are as received, i.e. before decompression. Header sizes are the HTTP/1
+        // text form, which overstates what HPACK actually sends on HTTP/2.
+        long request_size = 0, header_size = 0;
+        curl_off_t body_size = 0;
+        curl_easy_getinfo(handle, CURLINFO_REQUEST_SIZE, &request_size);
+        curl_easy_getinfo(handle, CURLINFO_HEADER_SIZE, &header_size);
+        curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &body_size);
+        
+        if (result == CURLE_OK) {
+            if (new_connections > 0) fresh_connections++;
+            else reused_connections++;
             
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-            curl_easy_setopt(curl, CURLOPT_USERAGENT, "KeyAuth");
-            curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+            long version = 0;
+            curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &version);
+            if (version == CURL_HTTP_VERSION_2_0) http2_transfers++;
             
-            res = curl_easy_perform(curl);
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.response_code);
-            curl_easy_cleanup(curl);
+            bytes_sent += (unsigned long long)request_size;
+            bytes_received += (unsigned long long)header_size + (unsigned long long)body_size;
         }
         
-        return response;
+        // libcurl reports offsets from the start of the transfer; the phases are the gaps between them
+        curl_off_t lookup = 0, connected = 0, handshake = 0, first_byte = 0, total = 0;
+        curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+        curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connected);
+        curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &handshake);
+        curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+        curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+        
+        auto gap = [](curl_off_t from, curl_off_t to) { return to > from ? (uint64_t)(to - from) : 0; };
+        const curl_off_t request_sent = std::max(connected, handshake);
+        
+        request_metrics::Sample sample;
+        sample.phase_us[request_metrics::dns] = gap(0, lookup);
+        sample.phase_us[request_metrics::connect] = gap(lookup, connected);
+        sample.phase_us[request_metrics::tls] = gap(connected, handshake);
+        sample.phase_us[request_metrics::first_byte] = gap(request_sent, first_byte);
+        sample.phase_us[request_metrics::total] = gap(0, total);
+        sample.new_connection = new_connections > 0;
+        sample.tls = handshake > 0;
+        sample.transport_error = result != CURLE_OK;
+        if (!sample.transport_error) curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &sample.status);
+        sample.bytes_sent = (uint64_t)request_size;
+        sample.bytes_received = (uint64_t)header_size + (uint64_t)body_size;
+        
+        endpoint_metrics[endpoint_index(post_data)].record(sample);
     }
     
-    std::string get_hwid() {
-        // Simple HWID generation based on system info
-        // In production, use more sophisticated methods
-        return "HWID-" + std::to_string(std::hash<std::string>{}("system_unique_id"));
+    // count_transfer() for a request that went through the backend: there are no connection
+    // phases to report, only the total time, the status and the bytes
+    void count_exchange(const APIResponse& response, const std::string& post_data) {
+        last_transfer_at = clock::now().time_since_epoch().count();
+        
+        request_metrics::Sample sample;
+        sample.phase_us[request_metrics::total] = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(response.elapsed).count();
+        sample.transport_error = response.result != CURLE_OK;
+        sample.status = sample.transport_error ? 0 : response.response_code;
+        sample.bytes_sent = post_data.size();
+        sample.bytes_received = response.data.size();
+        
+        endpoint_metrics[endpoint_index(post_data)].record(sample);
     }
     
-public:
-    KeyAuth(const std::string& name, const std::string& secret, const std::string& version) 
-        : app_name(name), app_secret(secret), app_version(version) {
-        hwid = get_hwid();
+    CURL* get_handle() {
+        if (curl) return curl;
+        
+        curl = curl_easy_init();
+        if (curl) setup_handle(curl);
+        return curl;
     }
     
-    struct AuthResult {
-        bool success;
-        std::string message;
-        std::string username;
-        std::string subscription;
-        std::string expiry;
-    };
+    CallPolicy get_call_policy() const {
+        std::lock_guard<std::mutex> lock(policy_mutex);
+        return call_policy;
+    }
     
-    bool init() {
-        std::map<std::string, std::string> data = {
-            {"type", "init"},
-            {"name", app_name},
-            {"ownerid", app_secret},
-            {"ver", app_version}
-        };
+    // Failed by RequestEngine::stop(): the client is shutting down
+    static bool is_aborted(const APIResponse& response) {
+        return response.result == CURLE_ABORTED_BY_CALLBACK;
+    }
+    
+    // Transport errors, 5xx and 429 say nothing about the request itself and may succeed on retry
+    static bool is_transient(const APIResponse& response) {
+        if (response.rejected || is_aborted(response)) return false;
+        if (response.result != CURLE_OK) return true;
+        return response.response_code >= 500 || response.response_code == 429;
+    }
+    
+    // Budget left before deadline, for CURLOPT_TIMEOUT_MS; zero once it has passed
+    static long remaining_ms(clock::time_point deadline) {
+        if (deadline == clock::time_point::max()) return 30000;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now()).count();
+        return left > 0 ? (long)left : 0;
+    }
+    
+    static clock::duration backoff(int attempt, const CallPolicy& policy) {
+        thread_local std::mt19937 rng{std::random_device{}()};
         
-        auto response = make_request("", data);
+        auto cap = policy.backoff_base.count() << std::min(attempt, 16);
+        cap = std::min<long long>(cap, policy.backoff_max.count());
+        std::uniform_int_distribution<long long> jitter(0, std::max<long long>(cap, 0));
+        return std::chrono::milliseconds(jitter(rng));
+    }
+    
+    void record_latency(clock::duration elapsed) {
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        if (latencies.size() < latency_window) {
+            latencies.push_back(elapsed);
+        } else {
+            latencies[latency_next] = elapsed;
+            latency_next = (latency_next + 1) % latency_window;
+        }
+    }
+    
+    // p95 of recent latencies; hedging stays off until there are enough samples to trust it
+    bool hedge_delay(clock::duration& delay) {
+        std::vector<clock::duration> samples;
+        {
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            if (latencies.size() < min_hedge_samples) return false;
+            samples = latencies;
+        }
         
-        if (response.response_code != 200) {
-            return false;
+        auto p95 = samples.begin() + (samples.size() * 95) / 100;
+        std::nth_element(samples.begin(), p95, samples.end());
+        delay = *p95;
+        return true;
+    }
+    
+    void record_outcome(const APIResponse& response) {
+        if (response.rejected || is_aborted(response)) return;
+        if (response.result == CURLE_OPERATION_TIMEDOUT) timeouts++;
+        
+        if (is_transient(response)) {
+            if (breaker.record_failure(get_call_policy().breaker_threshold)) schedule_probe();
+        } else {
+            breaker.record_success();
+            if (response.response_code == 200) record_latency(response.elapsed);
         }
+    }
+    
+    // Waits out the cooldown, then sends an empty request; any answer short of a 5xx
+    // means the backend is reachable again and closes the breaker
+    void schedule_probe() {
+        const CallPolicy policy = get_call_policy();
+        const auto start_at = clock::now() + policy.breaker_cooldown;
         
-        try {
-            Json::Value json_response;
-            Json::Reader reader;
-            
-            if (!reader.parse(response.data, json_response)) {
-                return false;
+        engine.submit(api_url, "", start_at + policy.deadline, [this](APIResponse& response) {
+            if (is_aborted(response)) return;
+            if (!is_transient(response)) {
+                breaker.record_success();
+                notify_completion();
+            } else if (breaker.record_failure(get_call_policy().breaker_threshold)) {
+                schedule_probe();
+            }
+        }, start_at, [this] { return breaker.begin_probe(); });
+    }
+    
+    APIResponse perform(const std::string& url, const std::string& post_data, clock::time_point deadline, bool idempotent) {
+        APIResponse response;
+        
+        if (!breaker.allow()) {
+            response.rejected = true;
+            rejected_calls++;
+            return response;
+        }
+        
+        long budget = remaining_ms(deadline);
+        if (budget <= 0) {
+            response.result = CURLE_OPERATION_TIMEDOUT;
+            return response;
+        }
+        
+        if (backend) {
+            const auto started = clock::now();
+            backend->send({url, post_data, deadline}, response);
+            response.elapsed = clock::now() - started;
+            count_exchange(response, post_data);
+        } else {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            CURL* handle = get_handle();
+            if (!handle) {
+                response.result = CURLE_FAILED_INIT;
+                return response;
             }
             
-            if (json_response["success"].asBool()) {
-                session_id = json_response["sessionid"].asString();
-                initialized = true;
-                return true;
+            const auto started = clock::now();
+            TransportMode sent;
+            do {
+                response = {};
+                sent = apply_transport(handle);
+                curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(handle, CURLOPT_POSTFIELDS, post_data.c_str());
+                curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response);
+                curl_easy_setopt(handle, CURLOPT_HEADERDATA, &response);
+                curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, std::max(remaining_ms(deadline), 1L));
+                
+                response.result = curl_easy_perform(handle);
+                count_transfer(handle, response.result, post_data);
+            } while (fall_back_transport(handle, response.result, idempotent, sent));
+            response.elapsed = clock::now() - started;
+            curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.response_code);
+        }
+        
+        record_outcome(response);
+        return response;
+    }
+    
+    // Blocking call. Idempotent requests are retried with jittered exponential backoff
+    // until they succeed, fail for a non-transient reason or run out of deadline budget.
+    APIResponse make_request(const std::string& post_data, bool idempotent = false) {
+        KEYAUTH_TRACE_SCOPE("KeyAuth::make_request", metric_endpoints[endpoint_index(post_data)]);
+        
+        // Followers block until the leader's result lands; the waiter runs before get() returns
+        std::promise<APIResponse> shared;
+        if (join_flight(post_data, [&shared](APIResponse& response) { shared.set_value(response); })) {
+            return shared.get_future().get();
+        }
+        
+        const CallPolicy policy = get_call_policy();
+        APIResponse response;
+        if (!admit(post_data, policy, response)) {
+            land_flight(post_data, response);
+            return response;
+        }
+        
+        const auto deadline = clock::now() + policy.deadline;
+        const int attempts = idempotent ? std::max(policy.max_attempts, 1) : 1;
+        
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            if (attempt > 0) {
+                auto delay = backoff(attempt - 1, policy);
+                if (clock::now() + delay >= deadline) break;
+                std::this_thread::sleep_for(delay);
+                retries++;
             }
-        } catch (...) {
+            
+            response = perform(api_url, post_data, deadline, idempotent);
+            if (!is_transient(response)) break;
+        }
+        
+        land_flight(post_data, response);
+        return response;
+    }
+    
+    // Single flight: identical requests (same endpoint and parameters, i.e. the same encoded
+    // body) that overlap share one network result. The first caller leads and sends it; later
+    // ones register a waiter and are answered when the leader lands the flight.
+    struct Flight {
+        std::vector<std::function<void(APIResponse&)>> waiters;
+    };
+    
+    std::mutex flights_mutex;
+    std::unordered_map<std::string, Flight> flights;
+    
+    // True if an identical request is in flight and waiter will get its response; false if
+    // the caller is now the leader and must call land_flight() when done
+    bool join_flight(const std::string& key, std::function<void(APIResponse&)> waiter) {
+        std::lock_guard<std::mutex> lock(flights_mutex);
+        auto it = flights.find(key);
+        if (it == flights.end()) {
+            flights.emplace(key, Flight());
             return false;
         }
         
+        it->second.waiters.push_back(std::move(waiter));
+        coalesced_calls++;
+        return true;
+    }
+    
+    void land_flight(const std::string& key, const APIResponse& response) {
+        std::vector<std::function<void(APIResponse&)>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(flights_mutex);
+            auto it = flights.find(key);
+            if (it == flights.end()) return;
+            waiters = std::move(it->second.waiters);
+            flights.erase(it);
+        }
+        
+        for (auto& waiter : waiters) {
+            APIResponse copy = response;
+            waiter(copy);
+        }
+    }
+    
+    // One token per logical call from the endpoint's bucket; retries and hedges of an admitted
+    // call, coalesced followers, probes, pre-connects and heartbeats don't take one
+    TokenBucket rate_limits[metric_endpoint_count];
+    
+    bool admit(const std::string& post_data, const CallPolicy& policy, APIResponse& response) {
+        if (policy.rate_per_second <= 0.0) return true;
+        if (rate_limits[endpoint_index(post_data)].take(policy.rate_per_second, std::max(policy.rate_burst, 1.0), clock::now())) return true;
+        
+        throttled_calls++;
+        response.rejected = true;
+        response.throttled = true;
         return false;
     }
     
-    AuthResult login(const std::string& user, const std::string& pass) {
-        AuthResult result = {false, "", "", "", ""};
+    // Event loop on top of curl_multi. Requests submitted from any thread are driven
+    // concurrently by a single worker thread; they share one connection cache and are
+    // multiplexed as HTTP/2 streams when the server negotiates it. Transfers can be delayed
+    // (retry backoff, hedges, probes) and gated: a gate returning false drops the transfer
+    // without sending it or calling its completion. Only idempotent transfers are resent
+    // after a transport fallback, see fall_back_transport().
+    class RequestEngine {
+    public:
+        using Completion = std::function<void(APIResponse&)>;
+        using Gate = std::function<bool()>;
         
-        if (!initialized) {
-            result.message = "KeyAuth not initialized";
-            return result;
+        explicit RequestEngine(KeyAuth& owner) : owner(owner) {}
+        
+        ~RequestEngine() {
+            stop();
         }
         
-        std::map<std::string, std::string> data = {
-            {"type", "login"},
-            {"username", user},
-            {"pass", pass},
-            {"hwid", hwid},
-            {"sessionid", session_id}
+        void submit(const std::string& url, std::string post_data, clock::time_point deadline, Completion done,
+                    clock::time_point start_at = clock::time_point(), Gate gate = nullptr, bool idempotent = true) {
+            auto transfer = std::make_unique<Transfer>();
+            transfer->url = url;
+            transfer->post_data = std::move(post_data);
+            transfer->deadline = deadline;
+            transfer->start_at = start_at;
+            transfer->gate = std::move(gate);
+            transfer->idempotent = idempotent;
+            transfer->done = std::move(done);
+            
+            CURLcode failure;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                if (start()) {
+                    queued.push_back(std::move(transfer));
+                    curl_multi_wakeup(multi);
+                    return;
+                }
+                failure = stopped ? CURLE_ABORTED_BY_CALLBACK : CURLE_FAILED_INIT;
+            }
+            
+            // Unlocked, since the completion may well submit again
+            transfer->response.result = failure;
+            transfer->done(transfer->response);
+        }
+        
+        // Fails every transfer that has not finished yet with CURLE_ABORTED_BY_CALLBACK, so no
+        // future or single flight is left waiting, and does the same to any submitted later
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                stopped = true;
+                if (!running) return;
+                running = false;
+                curl_multi_wakeup(multi);
+            }
+            worker.join();
+            
+            std::vector<std::unique_ptr<Transfer>> unfinished;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                unfinished.swap(queued);
+            }
+            for (auto& transfer : active) {
+                curl_multi_remove_handle(multi, transfer->easy);
+                curl_easy_cleanup(transfer->easy);
+                unfinished.push_back(std::move(transfer));
+            }
+            for (auto& transfer : waiting) unfinished.push_back(std::move(transfer));
+            for (CURL* easy : idle) curl_easy_cleanup(easy);
+            active.clear();
+            waiting.clear();
+            idle.clear();
+            
+            curl_multi_cleanup(multi);
+            multi = nullptr;
+            
+            for (auto& transfer : unfinished) {
+                transfer->response = {};
+                transfer->response.result = CURLE_ABORTED_BY_CALLBACK;
+                transfer->done(transfer->response);
+            }
+        }
+    
+    private:
+        struct Transfer {
+            CURL* easy = nullptr;
+            std::string url;
+            std::string post_data;
+            clock::time_point deadline;
+            clock::time_point start_at;
+            clock::time_point started;
+            Gate gate;
+            bool idempotent = true;
+            TransportMode sent = TransportMode::optimized; // mode of the latest attempt
+            APIResponse response;
+            Completion done;
         };
         
-        auto response = make_request("", data);
+        KeyAuth& owner;
+        CURLM* multi = nullptr;
+        std::thread worker;
+        bool running = false;
+        bool stopped = false; // for good: start() no longer brings the worker up
         
-        if (response.response_code != 200) {
-            result.message = "Network error";
-            return result;
+        std::mutex queue_mutex;
+        std::vector<std::unique_ptr<Transfer>> queued;
+        
+        // Only touched by the worker thread
+        std::vector<std::unique_ptr<Transfer>> active;
+        std::vector<std::unique_ptr<Transfer>> waiting; // not yet due
+        std::vector<CURL*> idle;
+        
+        // Called with queue_mutex held
+        bool start() {
+            if (running) return true;
+            if (stopped) return false;
+            
+            multi = curl_multi_init();
+            if (!multi) return false;
+            
+            curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+            running = true;
+            worker = std::thread([this] { loop(); });
+            return true;
         }
         
-        try {
-            Json::Value json_response;
-            Json::Reader reader;
+        void attach(std::unique_ptr<Transfer> transfer) {
+            if (transfer->gate && !transfer->gate()) return;
             
-            if (!reader.parse(response.data, json_response)) {
-                result.message = "Invalid response format";
-                return result;
+            long budget = remaining_ms(transfer->deadline);
+            if (budget <= 0) {
+                transfer->response.result = CURLE_OPERATION_TIMEDOUT;
+                transfer->done(transfer->response);
+                return;
             }
             
-            if (json_response["success"].asBool()) {
-                username = json_response["info"]["username"].asString();
-                subscription = json_response["info"]["subscriptions"][0]["subscription"].asString();
-                expiry = json_response["info"]["subscriptions"][0]["expiry"].asString();
-                
-                logged_in = true;
-                result.success = true;
-                result.username = username;
-                result.subscription = subscription;
-                result.expiry = expiry;
-                result.message = "Login successful";
+            // A backend answers in place on this thread; there is nothing for curl_multi to drive
+            if (owner.backend) {
+                transfer->started = clock::now();
+                owner.backend->send({transfer->url, transfer->post_data, transfer->deadline}, transfer->response);
+                transfer->response.elapsed = clock::now() - transfer->started;
+                if (trace::enabled) {
+                    trace::complete("transfer", metric_endpoints[owner.endpoint_index(transfer->post_data)], trace::to_ns(transfer->started), trace::now_ns());
+                }
+                owner.count_exchange(transfer->response, transfer->post_data);
+                transfer->done(transfer->response);
+                return;
+            }
+            
+            CURL* easy = nullptr;
+            if (!idle.empty()) {
+                easy = idle.back();
+                idle.pop_back();
             } else {
-                result.message = json_response["message"].asString();
+                easy = curl_easy_init();
+                if (!easy) {
+                    transfer->response.result = CURLE_FAILED_INIT;
+                    transfer->done(transfer->response);
+                    return;
+                }
+                owner.setup_handle(easy);
+                // Prefer waiting for an existing connection to multiplex over opening a new one
+                curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
             }
-        } catch (...) {
-            result.message = "Error parsing response";
+            
+            transfer->easy = easy;
+            transfer->sent = owner.apply_transport(easy);
+            curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->post_data.c_str());
+            curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response);
+            curl_easy_setopt(easy, CURLOPT_HEADERDATA, &transfer->response);
+            curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, budget);
+            curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer.get());
+            
+            transfer->started = clock::now();
+            curl_multi_add_handle(multi, easy);
+            active.push_back(std::move(transfer));
         }
         
-        return result;
+        void complete(CURL* easy, CURLcode result) {
+            for (auto it = active.begin(); it != active.end(); ++it) {
+                if ((*it)->easy != easy) continue;
+                
+                std::unique_ptr<Transfer> transfer = std::move(*it);
+                active.erase(it);
+                
+                curl_multi_remove_handle(multi, easy);
+                owner.count_transfer(easy, result, transfer->post_data);
+                
+                // Resend from scratch in compatible mode; same deadline, not counted as a retry.
+                // The gate already let this transfer through: running it again would count a
+                // hedge twice and find a breaker probe already begun.
+                if (owner.fall_back_transport(easy, result, transfer->idempotent, transfer->sent)) {
+                    idle.push_back(easy);
+                    transfer->easy = nullptr;
+                    transfer->gate = nullptr;
+                    transfer->response = {};
+                    attach(std::move(transfer));
+                    return;
+                }
+                
+                transfer->response.result = result;
+                transfer->response.elapsed = clock::now() - transfer->started;
+                if (trace::enabled) {
+                    trace::complete("transfer", metric_endpoints[owner.endpoint_index(transfer->post_data)], trace::to_ns(transfer->started), trace::now_ns());
+                }
+                curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.response_code);
+                idle.push_back(easy);
+                
+                transfer->done(transfer->response);
+                return;
+            }
+        }
+        
+        void loop() {
+            KEYAUTH_TRACE_THREAD("network");
+            for (;;) {
+                std::vector<std::unique_ptr<Transfer>> incoming;
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    if (!running) return;
+                    incoming.swap(queued);
+                }
+                
+                for (auto& transfer : incoming) waiting.push_back(std::move(transfer));
+                
+                // Start everything that is due; the rest bounds how long we may poll
+                const auto now = clock::now();
+                int poll_ms = 1000;
+                std::vector<std::unique_ptr<Transfer>> due;
+                for (auto it = waiting.begin(); it != waiting.end();) {
+                    if ((*it)->start_at <= now) {
+                        due.push_back(std::move(*it));
+                        it = waiting.erase(it);
+                    } else {
+                        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>((*it)->start_at - now).count() + 1;
+                        poll_ms = (int)std::min<long long>(poll_ms, wait);
+                        ++it;
+                    }
+                }
+                for (auto& transfer : due) attach(std::move(transfer));
+                
+                int still_running = 0;
+                curl_multi_perform(multi, &still_running);
+                
+                CURLMsg* msg = nullptr;
+                int msgs_left = 0;
+                while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+                    if (msg->msg == CURLMSG_DONE) complete(msg->easy_handle, msg->data.result);
+                }
+                
+                // Sleeps until socket activity, a libcurl timeout or curl_multi_wakeup()
+                curl_multi_poll(multi, nullptr, 0, poll_ms, nullptr);
+            }
+        }
+    };
+    
+    RequestEngine engine{*this};
+    
+    std::function<void()> completion_hook;
+    std::mutex hook_mutex;
+    
+    void notify_completion() {
+        std::function<void()> hook;
+        {
+            std::lock_guard<std::mutex> lock(hook_mutex);
+            hook = completion_hook;
+        }
+        if (hook) hook();
     }
     
-    AuthResult register_user(const std::string& user, const std::string& pass, const std::string& license) {
-        AuthResult result = {false, "", "", "", ""};
+    // Only requests that carry the HWID wait for the fingerprint, and by the time a user has
+    // typed their credentials it has long been computed
+    const std::string& hwid_id() const {
+        KEYAUTH_TRACE_SCOPE("KeyAuth::get_hwid");
+        return hwid_result.get().id;
+    }
+
+public:
+    // url and ca_bundle let the client target another deployment, e.g. a local HTTPS mock
+    // of the 1.2 API with a self-signed certificate for benchmarks. hwid_cache is where the
+    // hardware fingerprint is kept between runs; empty recomputes it every time. tls_cache is
+    // where TLS sessions are kept between runs (libcurl 8.12+); empty disables it. backend
+    // replaces libcurl for every request, e.g. with transport::keyauth_loopback() for tests.
+    KeyAuth(const std::string& name, const std::string& secret, const std::string& version,
+            const std::string& url = "https://keyauth.win/api/1.2/", const std::string& ca_bundle = "",
+            const std::string& hwid_cache = "", const std::string& tls_cache = "",
+            std::shared_ptr<transport::Transport> backend = nullptr)
+        : app_name(name), app_secret(secret), app_version(version), api_url(url), ca_bundle(ca_bundle), tls_cache_path(tls_cache),
+          backend(std::move(backend)) {
+        // Fingerprinting walks sysfs/the registry, so it runs off the constructor
+        hwid_result = std::async(std::launch::async, hwid::load_or_compute, hwid_cache).share();
         
-        if (!initialized) {
-            result.message = "KeyAuth not initialized";
-            return result;
+        // With a backend no request reaches libcurl, so there are no DNS results or TLS
+        // sessions to share or cache
+        if (!this->backend) share = curl_share_init();
+        if (share) {
+            curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lock_share);
+            curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+            curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
         }
         
-        std::map<std::string, std::string> data = {
-            {"type", "register"},
-            {"username", user},
-            {"pass", pass},
-            {"key", license},
-            {"hwid", hwid},
-            {"sessionid", session_id}
-        };
+        if (share && !tls_cache_path.empty()) {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            if (CURL* handle = get_handle()) tls_sessions_loaded = tls_cache::load(handle, tls_cache_path);
+        }
+        
+        update([](SessionSnapshot&) { return true; });
+    }
+    
+    ~KeyAuth() {
+        engine.stop();
+        
+        // Every handle has finished by now, so the share holds the newest tickets
+        if (share && !tls_cache_path.empty()) {
+            std::lock_guard<std::mutex> lock(request_mutex);
+            if (CURL* handle = get_handle()) tls_cache::save(handle, tls_cache_path);
+        }
+        
+        if (curl) curl_easy_cleanup(curl);
+        if (share) curl_share_cleanup(share);
+    }
+    
+    KeyAuth(const KeyAuth&) = delete;
+    KeyAuth& operator=(const KeyAuth&) = delete;
+    
+    // Everything needed to resume a validated session without logging in again
+    struct Session {
+        std::string session_id;
+        UserInfo user;
+        license_token::Token token; // empty if the server did not sign the login
+    };
+    
+    enum class OfflineStatus {
+        valid,   // signature checks out, not expired, signed within the grace window
+        stale,   // genuine but older than the grace window; needs an online check first
+        expired, // genuine but the subscription has run out
+        invalid  // no token, bad signature, other machine or unreadable body
+    };
+    
+    // Answer to "is this session still valid?" that keeps an outage apart from a rejection
+    enum class CheckStatus {
+        valid,
+        rejected,   // the server answered success:false, e.g. expired, banned or unknown session
+        unreachable // no answer: transport failure, error status or the breaker was open
+    };
+    
+    struct ConnectionStats {
+        unsigned long fresh = 0;
+        unsigned long reused = 0;
+        unsigned long http2 = 0;               // transfers that negotiated HTTP/2
+        unsigned long long bytes_sent = 0;     // request line, headers and body
+        unsigned long long bytes_received = 0; // headers and body as received (compressed)
+        unsigned long transport_fallbacks = 0;
+        TransportMode transport = TransportMode::optimized; // in effect, after any fallback
+        int tls_sessions_loaded = 0;   // resumable sessions read from the TLS cache at startup
+        unsigned long preconnects = 0; // sent by preconnect(), not skipped
+    };
+    
+    struct HeartbeatStats {
+        unsigned long beats = 0;         // checks that reached the network
+        unsigned long failures = 0;      // transport errors, 5xx or skipped while the breaker was open
+        unsigned long invalidations = 0; // sessions ended by the server or by expiry
+        double total_ms = 0.0;           // time spent in heartbeat requests
+        double last_ms = 0.0;
+    };
+
+private:
+    // Read lock-free by session(), replaced by update(). Each reader holds its own reference,
+    // so a replaced snapshot is freed when the last one lets go.
+    published::Value<SessionSnapshot> published_session;
+    
+    std::atomic<unsigned> heartbeat_generation{0};
+    std::atomic<long long> heartbeat_interval_ms{0};
+    std::atomic<unsigned long> heartbeat_beats{0};
+    std::atomic<unsigned long> heartbeat_failures{0};
+    std::atomic<unsigned long> heartbeat_invalidations{0};
+    std::atomic<long long> heartbeat_total_us{0};
+    std::atomic<long long> heartbeat_last_us{0};
+    
+    // The only way state changes: edit gets a copy of the current snapshot and returns false
+    // to leave things as they are; otherwise the copy is published. Returns whether it was.
+    template<class Edit>
+    bool update(Edit edit) {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        
+        const std::shared_ptr<const SessionSnapshot> current = published_session.load();
+        auto snapshot = current ? std::make_shared<SessionSnapshot>(*current) : std::make_shared<SessionSnapshot>();
+        if (!edit(*snapshot)) return false;
+        snapshot->version++;
+        snapshot->expiry = snapshot->user.expiry();
+        
+        published_session.store(std::move(snapshot));
+        return true;
+    }
+    
+    // Ends the session locally after the server rejected it or it ran out
+    void end_session(SessionSnapshot::State state, const std::string& reason) {
+        bool ended = update([&](SessionSnapshot& next) {
+            if (!next.active()) return false;
+            next.state = state;
+            next.reason = reason;
+            return true;
+        });
+        if (!ended) return;
+        
+        heartbeat_invalidations++;
+        heartbeat_generation++;
+        notify_completion();
+    }
+    
+    bool subscription_expired() const {
+        const time_t expiry = session()->expiry;
+        return expiry > 0 && expiry <= time(nullptr);
+    }
+    
+    // Beats are plain engine transfers: the gate decides at send time whether the beat is
+    // still wanted, and each completion schedules the next one
+    void schedule_heartbeat(unsigned generation, clock::time_point at) {
+        // Never sleep past the moment the subscription runs out
+        const time_t expiry = session()->expiry;
+        if (expiry > 0) {
+            const auto left = std::chrono::seconds(std::max<long long>((long long)(expiry - time(nullptr)), 0));
+            at = std::min(at, clock::now() + left);
+        }
+        
+        const CallPolicy policy = get_call_policy();
+        engine.submit(api_url, check_form(), at + policy.deadline, [this, generation](APIResponse& response) {
+            on_heartbeat(generation, response);
+        }, at, [this, generation] {
+            if (generation != heartbeat_generation) return false;
+            
+            if (subscription_expired()) {
+                end_session(SessionSnapshot::State::expired, "Subscription expired");
+                return false;
+            }
+            
+            if (!breaker.allow()) {
+                heartbeat_failures++;
+                schedule_heartbeat(generation, clock::now() + std::chrono::milliseconds(heartbeat_interval_ms.load()));
+                return false;
+            }
+            return true;
+        });
+    }
+    
+    void on_heartbeat(unsigned generation, const APIResponse& response) {
+        if (is_aborted(response)) return;
+        record_outcome(response);
         
-        auto response = make_request("", data);
+        const long long us = std::chrono::duration_cast<std::chrono::microseconds>(response.elapsed).count();
+        heartbeat_beats++;
+        heartbeat_total_us += us;
+        heartbeat_last_us = us;
+        
+        if (generation != heartbeat_generation) return;
+        
+        // Only a definite answer from the server ends the session; outages just skip a beat
+        if (response.response_code == 200) {
+            Result<Empty> result = decode_response<Empty>(response);
+            if (!result.success) {
+                end_session(SessionSnapshot::State::invalidated, result.message.empty() ? "Session is no longer valid" : result.message);
+                return;
+            }
+        } else {
+            heartbeat_failures++;
+        }
+        
+        schedule_heartbeat(generation, clock::now() + std::chrono::milliseconds(heartbeat_interval_ms.load()));
+    }
+
+private:
+    // Form bodies are encoded into the calling thread's request::scratch() buffer; the
+    // returned reference is valid until the next *_form call on that thread
+    const std::string& init_form() const {
+        std::string& out = request::scratch();
+        request::encode<request::Init>(out, app_name, app_secret, app_version);
+        return out;
+    }
+    
+    const std::string& login_form(const std::string& user, const std::string& pass) const {
+        std::string& out = request::scratch();
+        request::encode<request::Login>(out, user, pass, hwid_id(), session()->session_id);
+        return out;
+    }
+    
+    const std::string& register_form(const std::string& user, const std::string& pass, const std::string& license) const {
+        std::string& out = request::scratch();
+        request::encode<request::Register>(out, user, pass, license, hwid_id(), session()->session_id);
+        return out;
+    }
+    
+    const std::string& license_form(const std::string& license) const {
+        std::string& out = request::scratch();
+        request::encode<request::License>(out, license, hwid_id(), session()->session_id);
+        return out;
+    }
+    
+    const std::string& check_form() const {
+        std::string& out = request::scratch();
+        request::encode<request::Check>(out, session()->session_id, app_name, app_secret);
+        return out;
+    }
+    
+    // Why a request produced no usable body, in words the user can act on
+    static std::string transport_error(const APIResponse& response) {
+        if (response.throttled) return "Too many requests, try again shortly";
+        if (response.rejected) return "Server unavailable, try again shortly";
+        if (response.result == CURLE_OPERATION_TIMEDOUT) return "Request timed out";
+        if (response.result != CURLE_OK) return std::string("Network error: ") + curl_easy_strerror(response.result);
+        return "Server error (HTTP " + std::to_string(response.response_code) + ")";
+    }
+    
+    void set_last_error(const std::string& error) {
+        update([&](SessionSnapshot& next) {
+            next.last_error = error;
+            return true;
+        });
+    }
+    
+    struct Empty {};
+    
+    struct InitInfo {
+        std::string session_id;
+    };
+    
+    static void decode(const decoder::Value& node, Subscription& out) {
+        node.each_member([&](std::string_view key, const decoder::Value& value) {
+            if (key == "subscription") out.name = value.as_string();
+            else if (key == "key") out.key = value.as_string();
+            else if (key == "expiry") out.expiry = (time_t)value.as_int();
+            else if (key == "timeleft") out.timeleft = value.as_int();
+        });
+    }
+    
+    static void decode(const decoder::Value& node, UserInfo& out) {
+        node.each_member([&](std::string_view key, const decoder::Value& value) {
+            if (key == "username") out.username = value.as_string();
+            else if (key == "ip") out.ip = value.as_string();
+            else if (key == "hwid") out.hwid = value.as_string();
+            else if (key == "createdate") out.created = (time_t)value.as_int();
+            else if (key == "lastlogin") out.last_login = (time_t)value.as_int();
+            else if (key == "subscriptions") {
+                value.each([&](const decoder::Value& element) {
+                    out.subscriptions.emplace_back();
+                    decode(element, out.subscriptions.back());
+                });
+            }
+        });
+    }
+    
+    // Top-level fields besides success/message, per payload type
+    static void decode_field(std::string_view key, const decoder::Value& value, UserInfo& out) {
+        if (key == "info") decode(value, out);
+    }
+    
+    static void decode_field(std::string_view key, const decoder::Value& value, InitInfo& out) {
+        if (key == "sessionid") out.session_id = value.as_string();
+    }
+    
+    static void decode_field(std::string_view, const decoder::Value&, Empty&) {}
+    
+    // The one place a response body is interpreted: transport failures become messages and
+    // the body is mapped into Result<T> in a single scan of the top-level object
+    template<class T>
+    static Result<T> decode_response(const APIResponse& response) {
+        KEYAUTH_TRACE_SCOPE("KeyAuth::decode_response");
+        Result<T> result;
         
         if (response.response_code != 200) {
-            result.message = "Network error";
+            result.message = transport_error(response);
             return result;
         }
         
         try {
-            Json::Value json_response;
-            Json::Reader reader;
+            decoder::Document json_response;
             
-            if (!reader.parse(response.data, json_response)) {
+            if (!json_response.parse(response.data)) {
                 result.message = "Invalid response format";
                 return result;
             }
             
-            if (json_response["success"].asBool()) {
-                result.success = true;
-                result.message = "Registration successful";
-            } else {
-                result.message = json_response["message"].asString();
-            }
+            json_response.each_member([&](std::string_view key, const decoder::Value& value) {
+                if (key == "success") result.success = value.as_bool();
+                else if (key == "message") result.message = value.as_string();
+                else decode_field(key, value, result.value);
+            });
         } catch (...) {
+            result = {};
             result.message = "Error parsing response";
         }
         
         return result;
     }
     
-    AuthResult license_login(const std::string& license) {
-        AuthResult result = {false, "", "", "", ""};
-        
-        if (!initialized) {
-            result.message = "KeyAuth not initialized";
-            return result;
-        }
+    template<class T>
+    Result<T> call(const std::string& post_data, bool idempotent = false) {
+        return decode_response<T>(make_request(post_data, idempotent));
+    }
+    
+    // Async counterpart of call(); apply runs on the network thread and produces the future's value
+    template<class T, class Apply>
+    auto call_async(const std::string& post_data, Apply apply, bool idempotent = false) {
+        using Out = decltype(apply(std::declval<Result<T>>()));
+        return submit<Out>(post_data, [apply](const APIResponse& response) { return apply(decode_response<T>(response)); }, idempotent);
+    }
+    
+    bool apply_init(const Result<InitInfo>& result) {
+        update([&](SessionSnapshot& next) {
+            if (result.success) {
+                next.session_id = result.value.session_id;
+                next.initialized = true;
+                next.last_error.clear();
+            } else {
+                next.last_error = result.message;
+            }
+            return true;
+        });
+        return result.success;
+    }
+    
+    // Shared by login and license_login, which return the same user info payload. Takes the
+    // raw response because the signed body is kept as the offline license token.
+    AuthResult apply_login(const APIResponse& response, const char* success_message) {
+        AuthResult result = decode_response<UserInfo>(response);
+        if (!result.success) return result;
         
-        std::map<std::string, std::string> data = {
-            {"type", "license"},
-            {"key", license},
-            {"hwid", hwid},
-            {"sessionid", session_id}
-        };
+        result.message = success_message;
         
-        auto response = make_request("", data);
+        update([&](SessionSnapshot& next) {
+            next.user = result.value;
+            next.state = SessionSnapshot::State::active;
+            next.reason.clear();
+            next.token = { response.data, response.signature_timestamp, response.signature };
+            return true;
+        });
+        return result;
+    }
+    
+    AuthResult apply_register(AuthResult result) {
+        if (result.success) result.message = "Registration successful";
+        return result;
+    }
+    
+    bool apply_check(const Result<Empty>& result) {
+        if (!result.success) set_last_error(result.message);
+        return result.success;
+    }
+    
+    AuthResult not_initialized() const {
+        AuthResult result;
+        result.message = "KeyAuth not initialized";
+        return result;
+    }
+    
+    // One logical async call. Its attempts (retries and at most one hedge) race to resolve it
+    // exactly once; the first non-transient answer wins and later copies are dropped unsent.
+    struct Call {
+        std::string url;
+        std::string post_data;
+        CallPolicy policy;
+        clock::time_point deadline;
+        bool idempotent = false;
+        std::function<void(APIResponse&)> resolve;
         
-        if (response.response_code != 200) {
-            result.message = "Network error";
-            return result;
+        std::mutex mutex;
+        int attempts = 0;
+        int in_flight = 0;
+        bool done = false;
+    };
+    
+    void dispatch(const std::shared_ptr<Call>& call, clock::time_point start_at, bool hedge = false) {
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            call->attempts++;
+            call->in_flight++;
         }
         
-        try {
-            Json::Value json_response;
-            Json::Reader reader;
+        // Runs when the attempt is due, so the breaker sees the state at send time, not submit time
+        auto gate = [this, call, hedge] {
+            std::unique_lock<std::mutex> lock(call->mutex);
+            if (call->done) return false;
             
-            if (!reader.parse(response.data, json_response)) {
-                result.message = "Invalid response format";
-                return result;
+            if (!breaker.allow()) {
+                rejected_calls++;
+                if (--call->in_flight > 0) return false;
+                
+                call->done = true;
+                lock.unlock();
+                APIResponse response;
+                response.rejected = true;
+                call->resolve(response);
+                return false;
             }
             
-            if (json_response["success"].asBool()) {
-                username = json_response["info"]["username"].asString();
-                subscription = json_response["info"]["subscriptions"][0]["subscription"].asString();
-                expiry = json_response["info"]["subscriptions"][0]["expiry"].asString();
-                
-                logged_in = true;
-                result.success = true;
-                result.username = username;
-                result.subscription = subscription;
-                result.expiry = expiry;
-                result.message = "License login successful";
-            } else {
-                result.message = json_response["message"].asString();
+            if (hedge) hedges++;
+            return true;
+        };
+        
+        engine.submit(call->url, call->post_data, call->deadline, [this, call, hedge](APIResponse& response) {
+            on_attempt_done(call, response, hedge);
+        }, start_at, gate, call->idempotent);
+    }
+    
+    void on_attempt_done(const std::shared_ptr<Call>& call, APIResponse& response, bool hedge) {
+        record_outcome(response);
+        
+        std::unique_lock<std::mutex> lock(call->mutex);
+        call->in_flight--;
+        if (call->done) return;
+        
+        if (is_transient(response)) {
+            // The other copy may still come back with an answer
+            if (call->in_flight > 0) return;
+            
+            if (call->idempotent && call->attempts < call->policy.max_attempts) {
+                auto retry_at = clock::now() + backoff(call->attempts - 1, call->policy);
+                if (retry_at < call->deadline) {
+                    lock.unlock();
+                    retries++;
+                    dispatch(call, retry_at);
+                    return;
+                }
             }
-        } catch (...) {
-            result.message = "Error parsing response";
+        } else if (hedge) {
+            hedge_wins++;
         }
         
-        return result;
+        call->done = true;
+        lock.unlock();
+        call->resolve(response);
+    }
+    
+    // Queues a request on the multi engine and resolves the future from its worker thread
+    template<class T, class Handler>
+    std::future<T> submit(const std::string& post_data, Handler handler, bool idempotent = false) {
+        auto promise = std::make_shared<std::promise<T>>();
+        std::future<T> future = promise->get_future();
+        
+        auto resolve = [this, promise, handler](APIResponse& response) {
+            promise->set_value(handler(response));
+            notify_completion();
+        };
+        if (join_flight(post_data, resolve)) return future;
+        
+        auto call = std::make_shared<Call>();
+        call->url = api_url;
+        call->post_data = post_data;
+        call->policy = get_call_policy();
+        call->deadline = clock::now() + call->policy.deadline;
+        call->idempotent = idempotent;
+        // The flight is landed first: a caller woken by the leader's future may immediately
+        // send the same request again, and that must start a new flight, not join this one
+        call->resolve = [this, resolve, key = post_data](APIResponse& response) {
+            land_flight(key, response);
+            resolve(response);
+        };
+        
+        APIResponse throttled;
+        if (!admit(post_data, call->policy, throttled)) {
+            call->resolve(throttled);
+            return future;
+        }
+        
+        clock::duration delay{};
+        const bool hedge = idempotent && call->policy.hedge && hedge_delay(delay);
+        
+        dispatch(call, clock::now());
+        if (hedge) dispatch(call, clock::now() + delay, true);
+        
+        return future;
+    }
+    
+    template<class T>
+    static std::future<T> ready(T value) {
+        std::promise<T> promise;
+        promise.set_value(std::move(value));
+        return promise.get_future();
+    }
+
+public:
+    bool init() {
+        KEYAUTH_TRACE_SCOPE("KeyAuth::init");
+        return apply_init(call<InitInfo>(init_form(), true));
+    }
+    
+    AuthResult login(const std::string& user, const std::string& pass) {
+        if (!is_initialized()) return not_initialized();
+        return apply_login(make_request(login_form(user, pass)), "Login successful");
+    }
+    
+    AuthResult register_user(const std::string& user, const std::string& pass, const std::string& license) {
+        if (!is_initialized()) return not_initialized();
+        return apply_register(call<UserInfo>(register_form(user, pass, license)));
+    }
+    
+    AuthResult license_login(const std::string& license) {
+        if (!is_initialized()) return not_initialized();
+        return apply_login(make_request(license_form(license)), "License login successful");
+    }
+    
+    // Asks the server whether the current session is still valid
+    bool check() {
+        if (!is_initialized()) return false;
+        return apply_check(call<Empty>(check_form(), true));
+    }
+    
+    // Non-blocking variants: requests are queued on the curl_multi engine, so several
+    // can be in flight at once on one network thread. Poll the future with
+    // wait_for(std::chrono::seconds(0)) once per frame instead of blocking on get().
+    std::future<bool> init_async() {
+        return call_async<InitInfo>(init_form(), [this](const Result<InitInfo>& result) { return apply_init(result); }, true);
+    }
+    
+    std::future<AuthResult> login_async(const std::string& user, const std::string& pass) {
+        if (!is_initialized()) return ready(not_initialized());
+        return submit<AuthResult>(login_form(user, pass), [this](const APIResponse& response) { return apply_login(response, "Login successful"); });
+    }
+    
+    std::future<AuthResult> register_user_async(const std::string& user, const std::string& pass, const std::string& license) {
+        if (!is_initialized()) return ready(not_initialized());
+        return call_async<UserInfo>(register_form(user, pass, license), [this](AuthResult result) { return apply_register(std::move(result)); });
+    }
+    
+    std::future<AuthResult> license_login_async(const std::string& license) {
+        if (!is_initialized()) return ready(not_initialized());
+        return submit<AuthResult>(license_form(license), [this](const APIResponse& response) { return apply_login(response, "License login successful"); });
+    }
+    
+    std::future<bool> check_async() {
+        if (!is_initialized()) return ready(false);
+        return call_async<Empty>(check_form(), [this](const Result<Empty>& result) { return apply_check(result); }, true);
+    }
+    
+    // check_async() for callers that must not act on an outage as if the server had said no,
+    // e.g. before deleting a saved session. Like the heartbeat, only a 200 reply is an answer.
+    std::future<CheckStatus> check_status_async() {
+        if (!is_initialized()) return ready(CheckStatus::rejected);
+        return submit<CheckStatus>(check_form(), [this](const APIResponse& response) {
+            const bool answered = response.response_code == 200;
+            if (!apply_check(decode_response<Empty>(response))) return answered ? CheckStatus::rejected : CheckStatus::unreachable;
+            return CheckStatus::valid;
+        }, true);
+    }
+    
+    bool is_initialized() const {
+        return session()->initialized;
     }
     
     bool is_logged_in() const {
-        return logged_in;
+        return session()->active();
     }
     
     std::string get_username() const {
-        return username;
+        return session()->user.username;
     }
     
-    std::string get_subscription() const {
-        return subscription;
+    UserInfo get_user() const {
+        return session()->user;
     }
     
-    std::string get_expiry() const {
-        return expiry;
+    std::string get_session_id() const {
+        return session()->session_id;
     }
     
+    // Blocks only if the fingerprint is still being computed
     std::string get_hwid() const {
-        return hwid;
+        return hwid_id();
+    }
+    
+    // How long the fingerprint took and whether it came from the on-disk cache
+    hwid::Timing get_hwid_timing() const {
+        return hwid_result.get().timing;
+    }
+    
+    // Invoked on the network thread after any *_async future becomes ready, e.g. to wake
+    // an idle render loop so it can pick up the result
+    void set_completion_hook(std::function<void()> hook) {
+        std::lock_guard<std::mutex> lock(hook_mutex);
+        completion_hook = std::move(hook);
+    }
+    
+    // Applies to calls started after this returns
+    void set_call_policy(const CallPolicy& policy) {
+        std::lock_guard<std::mutex> lock(policy_mutex);
+        call_policy = policy;
+    }
+    
+    CallStats get_call_stats() const {
+        CallStats stats;
+        stats.retries = retries;
+        stats.hedges = hedges;
+        stats.hedge_wins = hedge_wins;
+        stats.rejected = rejected_calls;
+        stats.timeouts = timeouts;
+        stats.coalesced = coalesced_calls;
+        stats.throttled = throttled_calls;
+        stats.circuit_open = breaker.get_state() != CircuitBreaker::State::closed;
+        return stats;
+    }
+    
+    // Reason the last init()/check() failed, e.g. "Request timed out"
+    std::string get_last_error() const {
+        return session()->last_error;
+    }
+    
+    ConnectionStats get_connection_stats() const {
+        return { fresh_connections.load(), reused_connections.load(), http2_transfers.load(), bytes_sent.load(),
+                 bytes_received.load(), transport_fallbacks.load(), effective_transport(), tls_sessions_loaded, preconnects.load() };
+    }
+    
+    // Speculatively opens a connection to the API on the network thread, so a request the
+    // user is about to make (e.g. they started typing their credentials) finds it warm. Sends
+    // the same empty POST as the breaker probe, so the connection completes a full round trip
+    // and is pooled. Skipped while a recent transfer's connection is likely still alive. Only
+    // the *_async calls share that pool; the blocking ones keep a connection of their own.
+    void preconnect(std::chrono::milliseconds warm_for = std::chrono::milliseconds(15000)) {
+        const clock::time_point last{clock::duration(last_transfer_at.load())};
+        if (last_transfer_at.load() != 0 && clock::now() - last < warm_for) return;
+        if (breaker.get_state() != CircuitBreaker::State::closed) return;
+        if (backend) return; // no connection to warm
+        
+        // Claims the slot so a burst of calls sends one request
+        last_transfer_at = clock::now().time_since_epoch().count();
+        preconnects++;
+        engine.submit(api_url, std::string(), clock::now() + get_call_policy().deadline, [](const APIResponse&) {});
+    }
+    
+    // Per-endpoint phase timings, status classes and bytes since the client was created.
+    // Lock-free; may be called from any thread.
+    std::vector<request_metrics::EndpointSnapshot> metrics() const {
+        std::vector<request_metrics::EndpointSnapshot> endpoints;
+        endpoints.reserve(metric_endpoint_count);
+        for (const auto& endpoint : endpoint_metrics) endpoints.push_back(endpoint.snapshot());
+        return endpoints;
+    }
+    
+    // Applies to requests started after this returns and re-arms the automatic fallback
+    void set_transport_mode(TransportMode mode) {
+        transport_mode = mode;
+        transport_fallback = false;
+    }
+    
+    Session get_session() const {
+        const auto state = session();
+        return { state->session_id, state->user, state->token };
+    }
+    
+    // Adopts a previously validated session (e.g. from the on-disk cache). The caller is
+    // expected to revalidate it with check()/check_async() and logout() if that fails.
+    void restore_session(const Session& session) {
+        update([&](SessionSnapshot& next) {
+            next.session_id = session.session_id;
+            next.user = session.user;
+            next.token = session.token;
+            next.initialized = true;
+            next.state = SessionSnapshot::State::active;
+            next.reason.clear();
+            return true;
+        });
     }
     
     void logout() {
-        logged_in = false;
-        username.clear();
-        subscription.clear();
-        expiry.clear();
+        stop_heartbeat();
+        
+        update([](SessionSnapshot& next) {
+            next.state = SessionSnapshot::State::logged_out;
+            next.user = {};
+            next.token = {};
+            next.reason.clear();
+            return true;
+        });
+    }
+    
+    // Checks a cached session's license token without touching the network. Only a valid
+    // token restores the session, and then the user info comes from the signed body rather
+    // than from the cache. Start the heartbeat afterwards to revalidate online in the background.
+    OfflineStatus restore_offline(const Session& cached, const std::string& public_key, std::chrono::seconds grace) {
+        if (cached.token.empty() || !license_token::verify(cached.token, public_key)) return OfflineStatus::invalid;
+        
+        APIResponse response;
+        response.data = cached.token.body;
+        response.response_code = 200;
+        AuthResult signed_login = decode_response<UserInfo>(response);
+        if (!signed_login.success) return OfflineStatus::invalid;
+        
+        // A token lifted from another machine verifies fine, so check whose it is
+        const std::string& signed_hwid = signed_login.value.hwid;
+        if (!signed_hwid.empty() && signed_hwid != hwid_id()) return OfflineStatus::invalid;
+        
+        const long long now = (long long)time(nullptr);
+        const long long signed_at = strtoll(cached.token.timestamp.c_str(), nullptr, 10);
+        if (signed_at <= 0 || signed_at > now + 300) return OfflineStatus::invalid;
+        if (signed_login.value.expiry() <= now) return OfflineStatus::expired;
+        if (now - signed_at > grace.count()) return OfflineStatus::stale;
+        
+        restore_session({ cached.session_id, signed_login.value, cached.token });
+        return OfflineStatus::valid;
+    }
+    
+    // Thread-safety guarantees:
+    //  - every public method may be called from any thread, concurrently
+    //  - session() takes no lock and never waits for a writer (see published.hpp), and the
+    //    snapshot it returns is internally consistent (never the user of one login with the
+    //    session id of another). It stays valid for as long as the caller holds it; load it
+    //    again once per frame or per operation to see newer state
+    //  - the getters below copy out of one snapshot; two getter calls may see two snapshots
+    //  - writes (init, login, restore_session, logout, heartbeat results) are serialised and
+    //    applied in completion order
+    std::shared_ptr<const SessionSnapshot> session() const {
+        return published_session.load();
+    }
+    
+    // Re-checks the session with the server every interval on the network thread (first check
+    // right away if check_now) until logout or stop_heartbeat(). A rejected or expired session
+    // ends the session, publishes an expired/invalidated snapshot and fires the completion hook.
+    void start_heartbeat(std::chrono::milliseconds interval, bool check_now = false) {
+        const unsigned generation = ++heartbeat_generation;
+        heartbeat_interval_ms = interval.count();
+        schedule_heartbeat(generation, check_now ? clock::now() : clock::now() + interval);
+    }
+    
+    void stop_heartbeat() {
+        heartbeat_generation++;
+    }
+    
+    HeartbeatStats get_heartbeat_stats() const {
+        HeartbeatStats stats;
+        stats.beats = heartbeat_beats;
+        stats.failures = heartbeat_failures;
+        stats.invalidations = heartbeat_invalidations;
+        stats.total_ms = heartbeat_total_us / 1000.0;
+        stats.last_ms = heartbeat_last_us / 1000.0;
+        return stats;
     }
 };
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#include "hex.hpp"
+
+#if defined(KEYAUTH_OFFLINE_LICENSE) || defined(KEYAUTH_LICENSE_SIGNER)
+#include <openssl/evp.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "libcrypto.lib")
+#endif
+#endif
+
+// Offline proof of a successful login.
+//
+// KeyAuth signs every response with Ed25519 over timestamp + body and sends the result in the
+// x-signature-timestamp / x-signature-ed25519 headers. Keeping the login response together with
+// those two headers lets a later launch re-check the user info and expiry locally against the
+// seller's public key, in microseconds and without a round trip.
+//
+// Verification uses OpenSSL and is compiled in with KEYAUTH_OFFLINE_LICENSE; without it every
+// token fails to verify and the client always validates online. KEYAUTH_LICENSE_SIGNER adds a
+// local signer standing in for the server, for tests and mock servers.
+namespace license_token {
+    struct Token {
+        std::string body;      // raw login response
+        std::string timestamp; // x-signature-timestamp, unix seconds
+        std::string signature; // x-signature-ed25519, hex
+
+        bool empty() const {
+            return signature.empty();
+        }
+    };
+
+    // True if signature is a valid Ed25519 signature of timestamp + body under public_key (hex)
+    inline bool verify(const Token& token, const std::string& public_key) {
+#ifdef KEYAUTH_OFFLINE_LICENSE
+        unsigned char key[32];
+        unsigned char signature[64];
+        if (!hex::decode(public_key, key, sizeof(key)) || !hex::decode(token.signature, signature, sizeof(signature))) return false;
+
+        EVP_PKEY* pkey = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, key, sizeof(key));
+        if (!pkey) return false;
+
+        bool valid = false;
+        if (EVP_MD_CTX* ctx = EVP_MD_CTX_new()) {
+            const std::string message = token.timestamp + token.body;
+            valid = EVP_DigestVerifyInit(ctx, nullptr, nullptr, nullptr, pkey) == 1 &&
+                    EVP_DigestVerify(ctx, signature, sizeof(signature), (const unsigned char*)message.data(), message.size()) == 1;
+            EVP_MD_CTX_free(ctx);
+        }
+
+        EVP_PKEY_free(pkey);
+        return valid;
+#else
+        (void)token;
+        (void)public_key;
+        return false;
+#endif
+    }
+
+#ifdef KEYAUTH_LICENSE_SIGNER
+    struct KeyPair {
+        std::string public_key;  // hex, for Config::LICENSE_PUBLIC_KEY
+        std::string private_key; // hex seed
+    };
+
+    inline KeyPair generate_keypair() {
+        KeyPair pair;
+        EVP_PKEY* pkey = nullptr;
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr);
+
+        if (ctx && EVP_PKEY_keygen_init(ctx) == 1 && EVP_PKEY_keygen(ctx, &pkey) == 1) {
+            unsigned char raw[32];
+            size_t size = sizeof(raw);
+            if (EVP_PKEY_get_raw_public_key(pkey, raw, &size) == 1) pair.public_key = hex::encode(raw, size);
+            size = sizeof(raw);
+            if (EVP_PKEY_get_raw_private_key(pkey, raw, &size) == 1) pair.private_key = hex::encode(raw, size);
+        }
+
+        EVP_PKEY_free(pkey);
+        EVP_PKEY_CTX_free(ctx);
+        return pair;
+    }
+
+    // Signs body the way the server does; returns an empty token on failure
+    inline Token sign(const std::string& private_key, const std::string& body, long long timestamp) {
+        Token token;
+        unsigned char seed[32];
+        if (!hex::decode(private_key, seed, sizeof(seed))) return token;
+
+        EVP_PKEY* pkey = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, seed, sizeof(seed));
+        if (!pkey) return token;
+
+        if (EVP_MD_CTX* ctx = EVP_MD_CTX_new()) {
+            const std::string stamp = std::to_string(timestamp);
+            const std::string message = stamp + body;
+            unsigned char signature[64];
+            size_t size = sizeof(signature);
+
+            if (EVP_DigestSignInit(ctx, nullptr, nullptr, nullptr, pkey) == 1 &&
+                EVP_DigestSign(ctx, signature, &size, (const unsigned char*)message.data(), message.size()) == 1) {
+                token.body = body;
+                token.timestamp = stamp;
+                token.signature = hex::encode(signature, size);
+            }
+            EVP_MD_CTX_free(ctx);
+        }
+
+        EVP_PKEY_free(pkey);
+        return token;
+    }
+#endif
+}
@@ -2,15 +2,27 @@
 #include "ui/ui.hpp"
 #include "keyauth.hpp"
 #include "config.hpp"
+#include "session_cache.hpp"
+#include "font_cache.hpp"
+#include "render_scheduler.hpp"
+#include "text_cache.hpp"
+#include "request_metrics.hpp"
+#include "static_layer.hpp"
+#include "trace.hpp"
+#ifdef _WIN32
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "dxgi.lib")
+#endif
 using namespace ui;
 
 #include "imgui/imgui_freetype.h"
 
+// c_main only needs ImGui; the D3D11/Win32 backend below is compiled on Windows only so the
+// UI can also be driven by the headless backend in headless.hpp
+#ifdef _WIN32
 inline static ID3D11Device* g_pd3dDevice = nullptr;
 inline static ID3D11DeviceContext* g_pd3dDeviceContext = nullptr;
 inline static IDXGISwapChain* g_pSwapChain = nullptr;
@@ -19,22 +31,177 @@ inline static UINT g_ResizeWidth = 0, g_ResizeHeight = 0;
 inline static ID3D11RenderTargetView* g_mainRenderTargetView = nullptr;
 void CreateRenderTarget( );
 void CleanupRenderTarget( );
+#endif
+
+inline static c_render_scheduler g_scheduler;
+inline static c_text_cache g_text_cache;
+inline static c_static_layer g_static_layer;
+inline static std::string g_font_cache_path; // set by c_main::initialize, also used by c_frame's rebuild
 
 class c_main {
 private:
-    KeyAuth keyauth{Config::KEYAUTH_APP_NAME, Config::KEYAUTH_APP_SECRET, Config::KEYAUTH_APP_VERSION};
+    KeyAuth keyauth;
     bool keyauth_initialized = false;
-    KeyAuth::AuthResult current_user;
+    std::vector< std::string > user_lines; // page 1 text, formatted once per session snapshot
+    unsigned long long user_lines_version = 0;
+    std::future<KeyAuth::AuthResult> pending_login;
+    std::future<bool> pending_init;
+    std::future<KeyAuth::CheckStatus> pending_revalidation; // saved session whose license token is past the grace window
+    bool revalidation_unreachable = false; // the server could not be asked; the saved session is kept for a retry
+    std::string error_msg;
+    char footer_date[32] = "";
+    time_t footer_date_expires = 0;
+    std::vector< request_metrics::EndpointSnapshot > diagnostics; // page 2, refreshed on a timer rather than per frame
+    std::chrono::steady_clock::time_point diagnostics_refresh;
+    std::shared_ptr< const KeyAuth::SessionSnapshot > frame_session; // taken once per frame by poll_background( )
 
 public:
+    struct startup_stats_t {
+        float first_usable_frame_ms = -1.f; // -1 until the login button or page 1 is usable
+        bool from_cache = false;
+
+        // Phase timings in ms. keyauth_init_ms is observed at frame granularity since the
+        // request completes on the network thread while the UI is already rendering.
+        float initialize_ms = 0.f;    // time initialize( ) blocked the caller
+        float fonts_ms = 0.f;         // style, font setup and atlas build
+        bool fonts_from_cache = false; // atlas came from the font cache file instead of FreeType
+        float keyauth_init_ms = -1.f; // -1 until the startup init has finished
+    };
+
+private:
+    std::chrono::steady_clock::time_point created_at = std::chrono::steady_clock::now( );
+    std::chrono::steady_clock::time_point init_started_at;
+    startup_stats_t startup_stats;
+
+    // User info is read from KeyAuth's session snapshot; the lines are only rebuilt (and the
+    // expiry dates formatted) when a new snapshot has been published
+    void update_user_lines( const KeyAuth::SessionSnapshot& session ) {
+        if ( session.version == user_lines_version )
+            return;
+
+        const KeyAuth::UserInfo& user = session.user;
+        user_lines_version = session.version;
+        user_lines.clear( );
+        user_lines.push_back( "Welcome back, " + user.username );
+
+        for ( const auto& sub : user.subscriptions ) {
+            char date[32] = "never";
+            if ( sub.expiry > 0 ) {
+                time_t expiry = sub.expiry;
+                strftime( date, sizeof( date ), "%b %d %Y", localtime( &expiry ) );
+            }
+            user_lines.push_back( sub.name + " - expires " + date );
+        }
+    }
+
+    static float ms_since( std::chrono::steady_clock::time_point start ) {
+        return std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now( ) - start ).count( );
+    }
+
+    // Completes background work started by initialize( ) / the login page; called once per frame
+    void poll_background( ) {
+        // Only the server saying no discards the saved session; an outage leaves it for a retry
+        if ( pending_revalidation.valid( ) && pending_revalidation.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ) {
+            switch ( pending_revalidation.get( ) ) {
+            case KeyAuth::CheckStatus::valid:
+                keyauth_initialized = true;
+                keyauth.start_heartbeat( Config::HEARTBEAT_INTERVAL );
+                cur_page = 1;
+                break;
+            case KeyAuth::CheckStatus::rejected:
+                session_cache::clear( Config::CREDENTIALS_FILE );
+                keyauth.logout( );
+                init_started_at = std::chrono::steady_clock::now( );
+                pending_init = keyauth.init_async( );
+                break;
+            case KeyAuth::CheckStatus::unreachable:
+                revalidation_unreachable = true;
+                break;
+            }
+        }
+
+        if ( pending_init.valid( ) && pending_init.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ) {
+            keyauth_initialized = pending_init.get( );
+            if ( startup_stats.keyauth_init_ms < 0.f )
+                startup_stats.keyauth_init_ms = ms_since( init_started_at );
+        }
+
+        // The snapshot for this frame, taken once: page 1 only renders it, so a session the
+        // heartbeat ends between two reads can never be seen there without being handled here.
+        frame_session = keyauth.session( );
+
+        // The heartbeat ended the session (server rejected it or the subscription ran out):
+        // drop the cached copy and fall back to a normal login with a fresh KeyAuth session.
+        // Runs whatever page is showing; logout( ) makes the state logged_out, so it runs once.
+        if ( frame_session->state == KeyAuth::SessionSnapshot::State::expired || frame_session->state == KeyAuth::SessionSnapshot::State::invalidated ) {
+            session_cache::clear( Config::CREDENTIALS_FILE );
+            keyauth.logout( );
+            keyauth_initialized = false;
+            error_msg = frame_session->reason + ", please log in again";
+            cur_page = 0;
+            init_started_at = std::chrono::steady_clock::now( );
+            pending_init = keyauth.init_async( );
+            frame_session = keyauth.session( );
+        }
+    }
+
+public:
+    // backend replaces libcurl for every KeyAuth request, e.g. transport::keyauth_loopback( ) so the
+    // headless frame benchmark renders the real pages without a server
+    explicit c_main( std::shared_ptr< transport::Transport > backend = nullptr )
+        : keyauth( Config::KEYAUTH_APP_NAME, Config::KEYAUTH_APP_SECRET, Config::KEYAUTH_APP_VERSION, Config::KEYAUTH_API_URL, Config::KEYAUTH_CA_BUNDLE,
+                   Config::HWID_CACHE_FILE, Config::TLS_CACHE_FILE, std::move( backend ) ) {
+    }
+
+    const startup_stats_t& get_startup_stats( ) const {
+        return startup_stats;
+    }
+
     void initialize( ImGuiIO& io ) {
-        // Initialize KeyAuth
-        keyauth_initialized = keyauth.init();
-        if (!keyauth_initialized) {
-            // Handle initialization error
-            MessageBoxA(NULL, "Failed to initialize KeyAuth. Check your internet connection.", "Error", MB_OK | MB_ICONERROR);
+        const auto initialize_start = std::chrono::steady_clock::now( );
+        KEYAUTH_TRACE_THREAD( "ui" );
+        KEYAUTH_TRACE_SCOPE( "c_main::initialize" );
+        trace::write_at_exit( Config::TRACE_FILE );
+
+        // Finished network calls must redraw an otherwise idle window
+        keyauth.set_completion_hook( [ ]( ) { g_scheduler.invalidate( ); } );
+        keyauth.set_transport_mode( Config::KEYAUTH_OPTIMIZED_TRANSPORT ? KeyAuth::TransportMode::optimized : KeyAuth::TransportMode::compatible );
+
+        // Resume the last validated session right away and revalidate it in the background. The
+        // HWID is the cache key, so the fingerprint is only waited for when there is a cache to read.
+        // With a license public key configured the session must also carry a genuine, unexpired
+        // signed token: within the grace window it is trusted until the next heartbeat, past it the
+        // server has to confirm the session before page 1 is shown.
+        KeyAuth::Session cached;
+        auto offline = KeyAuth::OfflineStatus::valid;
+        bool resumed = Config::REMEMBER_CREDENTIALS && session_cache::exists(Config::CREDENTIALS_FILE) && session_cache::load(Config::CREDENTIALS_FILE, keyauth.get_hwid(), cached);
+        if (resumed && !Config::LICENSE_PUBLIC_KEY.empty()) {
+            offline = keyauth.restore_offline(cached, Config::LICENSE_PUBLIC_KEY, Config::OFFLINE_GRACE);
+            if (offline == KeyAuth::OfflineStatus::invalid || offline == KeyAuth::OfflineStatus::expired) {
+                session_cache::clear(Config::CREDENTIALS_FILE);
+                resumed = false;
+            }
         }
 
+        if (resumed && offline == KeyAuth::OfflineStatus::stale) {
+            keyauth.restore_session(cached);
+            pending_revalidation = keyauth.check_status_async();
+            startup_stats.from_cache = true;
+        } else if (resumed) {
+            if (Config::LICENSE_PUBLIC_KEY.empty()) keyauth.restore_session(cached);
+            keyauth_initialized = true;
+            keyauth.start_heartbeat( Config::HEARTBEAT_INTERVAL, Config::LICENSE_PUBLIC_KEY.empty() );
+            startup_stats.from_cache = true;
+            cur_page = 1;
+        } else {
+            // Initialize KeyAuth on the network thread while fonts are rasterized below and the
+            // first frames render; the login button stays disabled until poll_background( ) sees it finish
+            init_started_at = std::chrono::steady_clock::now( );
+            pending_init = keyauth.init_async();
+        }
+
+        const auto fonts_start = std::chrono::steady_clock::now( );
+
         StyleColorsDark( );
 
         auto style = &ImGui::GetStyle( );
@@ -48,15 +215,19 @@ public:
         fonts[font].set_config( config );
         fonts[font].init( { Config::FONT_SIZE } );
 
-        ImGuiFreeType::BuildFontAtlas( io.Fonts );
+        g_font_cache_path = font_cache::default_path( Config::APP_TITLE );
+        font_cache::remove_legacy_files( );
+        font_cache::build( io.Fonts, Config::FONT_PATH, g_font_cache_path );
+
+        startup_stats.fonts_ms = ms_since( fonts_start );
+        startup_stats.fonts_from_cache = font_cache::last_build.from_cache;
 
         add_page( 0, [this]( ){
             static char username_buf[64] = "";
             static char password_buf[64] = "";
             static char license_buf[128] = "";
             static int login_mode = 0; // 0 = username/password, 1 = license key
-            static bool save_credentials = false;
-            static std::string error_msg = "";
+            static bool save_credentials = Config::REMEMBER_CREDENTIALS;
             static bool is_logging_in = false;
 
             BeginGroup( ); {
@@ -72,59 +243,72 @@ public:
                         
                         Dummy({ 0, 5 });
 
+                        bool started_typing = false;
                         if (login_mode == 0) {
                             // Username/Password login
                             InputText( "Username", username_buf, sizeof( username_buf ) );
+                            started_typing |= IsItemActivated( );
                             InputText( "Password", password_buf, sizeof( password_buf ), ImGuiInputTextFlags_Password );
+                            started_typing |= IsItemActivated( );
                         } else {
                             // License key login
                             InputText( "License Key", license_buf, sizeof( license_buf ) );
+                            started_typing |= IsItemActivated( );
                         }
+
+                        // Warm the connection while credentials are typed, so the login click doesn't
+                        // wait for DNS, TCP and TLS if the one from init has gone idle
+                        if ( started_typing && keyauth_initialized )
+                            keyauth.preconnect( );
                         
                         Dummy({ 0, 0 });
 
                         // Display error message if any
                         if ( !error_msg.empty() ) {
                             PushStyleColor(ImGuiCol_Text, IM_COL32(255, 100, 100, 255));
-                            add_text( font, Config::FONT_SIZE, { GetWindowPos( ).x + GetCursorPosX( ) + CalcItemWidth( ) / 2 - text_size( font, Config::FONT_SIZE, error_msg.c_str() ).x / 2, GetWindowPos( ).y + GetCursorPosY( ) - Config::FONT_SIZE - GImGui->Style.ItemSpacing.y / 2 + 1 }, GetColorU32( ImGuiCol_Text ), error_msg.c_str(), FindRenderedTextEnd( error_msg.c_str() ) );
+                            const auto& error_text = g_text_cache.get( font, Config::FONT_SIZE, error_msg.c_str() );
+                            add_text( font, Config::FONT_SIZE, { GetWindowPos( ).x + GetCursorPosX( ) + CalcItemWidth( ) / 2 - error_text.size.x / 2, GetWindowPos( ).y + GetCursorPosY( ) - Config::FONT_SIZE - GImGui->Style.ItemSpacing.y / 2 + 1 }, GetColorU32( ImGuiCol_Text ), error_text.begin( ), error_text.end( ) );
                             PopStyleColor();
                         }
 
                         // Login button
                         PushItemFlag(ImGuiItemFlags_Disabled, is_logging_in || !keyauth_initialized);
                         if ( Button( is_logging_in ? "Logging in..." : "Log in", { CalcItemWidth( ), 24 } ) ) {
-                            is_logging_in = true;
                             error_msg = "";
                             
-                            KeyAuth::AuthResult result;
                             if (login_mode == 0) {
                                 // Username/Password login
                                 if (strlen(username_buf) == 0 || strlen(password_buf) == 0) {
                                     error_msg = "Please enter username and password";
-                                    is_logging_in = false;
                                 } else {
-                                    result = keyauth.login(username_buf, password_buf);
+                                    pending_login = keyauth.login_async(username_buf, password_buf);
+                                    is_logging_in = true;
                                 }
                             } else {
                                 // License key login
                                 if (strlen(license_buf) == 0) {
                                     error_msg = "Please enter license key";
-                                    is_logging_in = false;
                                 } else {
-                                    result = keyauth.license_login(license_buf);
+                                    pending_login = keyauth.license_login_async(license_buf);
+                                    is_logging_in = true;
                                 }
                             }
-                            
-                            if (is_logging_in) {
-                                if (result.success) {
-                                    current_user = result;
-                                    cur_page = 1;
-                                    error_msg = "";
-                                } else {
-                                    error_msg = result.message;
+                        }
+                        
+                        // Poll the in-flight request once per frame so the UI keeps rendering
+                        if (is_logging_in && pending_login.valid() && pending_login.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                            KeyAuth::AuthResult result = pending_login.get();
+                            if (result.success) {
+                                keyauth.start_heartbeat( Config::HEARTBEAT_INTERVAL );
+                                if (save_credentials) {
+                                    session_cache::save(Config::CREDENTIALS_FILE, keyauth.get_session(), keyauth.get_hwid());
                                 }
-                                is_logging_in = false;
+                                cur_page = 1;
+                                error_msg = "";
+                            } else {
+                                error_msg = result.message;
                             }
+                            is_logging_in = false;
                         }
                         PopItemFlag();
                         
@@ -132,13 +316,31 @@ public:
                             exit( 0 );
                         }
                         
-                        Checkbox( "Save credentials", &save_credentials );
+                        // Unticking it also forgets a session saved by an earlier run
+                        if ( Checkbox( "Save credentials", &save_credentials ) && !save_credentials )
+                            session_cache::clear( Config::CREDENTIALS_FILE );
                         
                         if (!keyauth_initialized) {
                             Dummy({ 0, 5 });
-                            PushStyleColor(ImGuiCol_Text, IM_COL32(255, 200, 100, 255));
-                            TextWrapped("KeyAuth initialization failed. Please check your internet connection and app configuration.");
+                            if (pending_revalidation.valid()) {
+                                PushStyleColor(ImGuiCol_Text, GetColorU32(ImGuiCol_TextDisabled));
+                                TextWrapped("Validating saved session...");
+                            } else if (revalidation_unreachable) {
+                                PushStyleColor(ImGuiCol_Text, IM_COL32(255, 200, 100, 255));
+                                TextWrapped("Could not reach KeyAuth to validate the saved session (%s).", keyauth.get_last_error().c_str());
+                            } else if (pending_init.valid()) {
+                                PushStyleColor(ImGuiCol_Text, GetColorU32(ImGuiCol_TextDisabled));
+                                TextWrapped("Connecting to KeyAuth...");
+                            } else {
+                                PushStyleColor(ImGuiCol_Text, IM_COL32(255, 200, 100, 255));
+                                TextWrapped("KeyAuth initialization failed (%s). Please check your internet connection and app configuration.", keyauth.get_last_error().c_str());
+                            }
                             PopStyleColor();
+                            
+                            if (revalidation_unreachable && Button("Retry", { CalcItemWidth( ), 24 })) {
+                                revalidation_unreachable = false;
+                                pending_revalidation = keyauth.check_status_async();
+                            }
                         }
                     }
                     EndChild( );
@@ -150,8 +352,10 @@ public:
         } );
 
         add_page( 1, [this]( ){
-            // Validate user session
-            if (!keyauth.is_logged_in()) {
+            // This frame's snapshot; an expired or invalidated session has already been handled
+            // (cache cleared, re-init started) by poll_background( ), so only logged out is left
+            const auto& session = frame_session;
+            if (!session->active()) {
                 cur_page = 0; // Redirect to login
                 return;
             }
@@ -164,18 +368,17 @@ public:
             static std::vector< const char* > stages;
             static auto last_update = std::chrono::steady_clock::now( );
 
+            auto CenterEntry = [&]( const c_text_cache::entry_t& entry ) {
+                SetCursorPosX( GetCursorPosX( ) + CalcItemWidth( ) / 2 - entry.size.x / 2 );
+                TextUnformatted( entry.begin( ), entry.end( ) );
+            };
+
             auto CenterText = [&]( const char* text ) {
-                SetCursorPosX( GetCursorPosX( ) + CalcItemWidth( ) / 2 - text_size( font, 13, text ).x / 2 );
-                TextUnformatted( text );
+                CenterEntry( g_text_cache.get( font, 13, text ) );
             };
             
-            auto CenterTextF = [&]( const char* fmt, ... ) {
-                char buf[256];
-                va_list args;
-                va_start( args, fmt );
-                vsnprintf( buf, sizeof( buf ), fmt, args );
-                va_end( args );
-                CenterText( buf );
+            auto CenterTextF = [&]( const char* fmt, const auto&... args ) {
+                CenterEntry( g_text_cache.format( font, 13, fmt, args... ) );
             };
 
             BeginGroup( ); {
@@ -186,8 +389,10 @@ public:
                         PushItemFlag( ImGuiItemFlags_Disabled, stages.size( ) > 0 );
 
                         BeginChild( "cheat list", { CalcItemWidth( ), 100 }, 0, ImGuiWindowFlags_NoBackground ); {
-                            GetWindowDrawList( )->AddRectFilledMultiColor( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_FrameBg ), GetColorU32( ImGuiCol_FrameBg ), GetColorU32( ImGuiCol_FrameBg2 ), GetColorU32( ImGuiCol_FrameBg2 ) );
-                            GetWindowDrawList( )->AddRect( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_BorderShadow ) );
+                            g_static_layer.draw( GetWindowDrawList( ), GetID( "##chrome" ), GetWindowPos( ), GetWindowSize( ), [&]( ImDrawList* draw_list ) {
+                                draw_list->AddRectFilledMultiColor( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_FrameBg ), GetColorU32( ImGuiCol_FrameBg ), GetColorU32( ImGuiCol_FrameBg2 ), GetColorU32( ImGuiCol_FrameBg2 ) );
+                                draw_list->AddRect( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_BorderShadow ) );
+                            } );
 
                             PushStyleVar( ImGuiStyleVar_ItemSpacing, { 0, 0 } );
                             BeginGroup( ); {
@@ -210,15 +415,21 @@ public:
                         
                         if ( Button( "Logout", { CalcItemWidth( ), 24 } ) ) {
                             keyauth.logout();
+                            session_cache::clear(Config::CREDENTIALS_FILE);
                             cur_page = 0;
                         }
 
+                        if ( Config::SHOW_DIAGNOSTICS && Button( "Diagnostics", { CalcItemWidth( ), 24 } ) ) {
+                            diagnostics_refresh = {};
+                            cur_page = 2;
+                        }
+
                         PopItemFlag( );
                         
-                        if (keyauth.is_logged_in()) {
-                            CenterTextF( "Welcome back, %s", current_user.username.c_str() );
-                            CenterTextF( "Subscription: %s", current_user.subscription.c_str() );
-                            CenterTextF( "Expires: %s", current_user.expiry.c_str() );
+                        if (session->active()) {
+                            update_user_lines( *session );
+                            for ( const auto& line : user_lines )
+                                CenterText( line.c_str( ) );
                         } else {
                             CenterText( "Not logged in" );
                         }
@@ -246,6 +457,7 @@ public:
 
                             if ( !stages.empty( ) ) {
                                 CenterTextF( "%s [%d%%]", stages[cur_stage], percent );
+                                g_scheduler.schedule( last_update + std::chrono::milliseconds( delay_ms ) );
                             }
                         }
                     }
@@ -256,23 +468,98 @@ public:
             }
             EndGroup( );
         } );
+
+        if ( Config::SHOW_DIAGNOSTICS ) {
+            add_page( 2, [this]( ){
+                // The snapshot is lock-free but not free to copy, so it is taken twice a second
+                // and the scheduler wakes the idle loop for the next refresh
+                const auto now = std::chrono::steady_clock::now( );
+                if ( now >= diagnostics_refresh ) {
+                    diagnostics = keyauth.metrics( );
+                    diagnostics_refresh = now + std::chrono::milliseconds( 500 );
+                }
+                g_scheduler.schedule( diagnostics_refresh );
+
+                auto Line = [&]( const char* fmt, const auto&... args ) {
+                    const auto& entry = g_text_cache.format( font, 13, fmt, args... );
+                    TextUnformatted( entry.begin( ), entry.end( ) );
+                };
+
+                BeginGroup( ); {
+                    begin_child( "Network diagnostics" ); {
+                        PushStyleVar( ImGuiStyleVar_ItemSpacing, { 11, 4 } );
+                        PushStyleVar( ImGuiStyleVar_WindowPadding, { 15, 7 } );
+                        BeginChild( "diagnostics wrapper", GetContentRegionAvail( ), 0, ImGuiWindowFlags_AlwaysUseWindowPadding ); {
+                            if ( Button( "Back", { CalcItemWidth( ), 24 } ) )
+                                cur_page = frame_session->active( ) ? 1 : 0;
+
+                            if ( trace::enabled && Button( "Save trace", { CalcItemWidth( ), 24 } ) )
+                                trace::write( Config::TRACE_FILE );
+
+                            bool any = false;
+                            for ( const auto& endpoint : diagnostics ) {
+                                if ( !endpoint.requests )
+                                    continue;
+
+                                any = true;
+                                Line( "%s: %llu requests, %llu ok, %llu 4xx, %llu 5xx, %llu failed, %.1f / %.1f KB",
+                                      endpoint.name, ( unsigned long long )endpoint.requests, ( unsigned long long )endpoint.status_2xx,
+                                      ( unsigned long long )endpoint.status_4xx, ( unsigned long long )endpoint.status_5xx,
+                                      ( unsigned long long )endpoint.transport_errors, endpoint.bytes_sent / 1024.0, endpoint.bytes_received / 1024.0 );
+
+                                PushStyleColor( ImGuiCol_Text, GetColorU32( ImGuiCol_TextDisabled ) );
+                                for ( int phase = 0; phase < request_metrics::phase_count; ++phase ) {
+                                    const auto& histogram = endpoint.phases[phase];
+                                    if ( !histogram.count )
+                                        continue;
+
+                                    Line( "    %-10s p50 < %.1f ms  p95 < %.1f ms  mean %.2f ms  (%llu)", request_metrics::phase_names[phase],
+                                          histogram.percentile_ms( 0.5 ), histogram.percentile_ms( 0.95 ), histogram.mean_ms( ),
+                                          ( unsigned long long )histogram.count );
+                                }
+                                PopStyleColor( );
+                            }
+
+                            if ( !any )
+                                Line( "No requests yet" );
+                        }
+                        EndChild( );
+                        PopStyleVar( 2 );
+                    }
+                    end_child( );
+                }
+                EndGroup( );
+            } );
+        }
+
+        startup_stats.initialize_ms = ms_since( initialize_start );
     }
 
     void render( ) {
+        KEYAUTH_TRACE_SCOPE( "c_main::render" );
+        g_text_cache.new_frame( );
+        g_static_layer.new_frame( );
+        poll_background( );
+
         SetNextWindowPos({ 0, 0 });
         SetNextWindowSize( ui::size );
         Begin( "imgui base", 0, ImGuiWindowFlags_NoDecoration ); {
-            GetWindowDrawList( )->AddRect( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_BorderShadow ) );
-            GetWindowDrawList( )->AddRect( { GetWindowPos( ).x + 1, GetWindowPos( ).y + 1 }, { GetWindowPos( ).x + GetWindowWidth( ) - 1, GetWindowPos( ).y + GetWindowHeight( ) - 1 }, GetColorU32( ImGuiCol_Border ) );
+            // Window chrome only changes on resize or a style change, so it is tessellated once and replayed
+            g_static_layer.draw( GetWindowDrawList( ), GetID( "##chrome" ), GetWindowPos( ), GetWindowSize( ), [&]( ImDrawList* draw_list ) {
+                draw_list->AddRect( GetWindowPos( ), GetWindowPos( ) + GetWindowSize( ), GetColorU32( ImGuiCol_BorderShadow ) );
+                draw_list->AddRect( { GetWindowPos( ).x + 1, GetWindowPos( ).y + 1 }, { GetWindowPos( ).x + GetWindowWidth( ) - 1, GetWindowPos( ).y + GetWindowHeight( ) - 1 }, GetColorU32( ImGuiCol_Border ) );
+            } );
 
             SetCursorPos({ 2, 2 });
             BeginChild( "header", { GetWindowWidth( ) - 4, 26 } ); {
-                GetWindowDrawList( )->AddQuadFilled( { GetWindowPos( ).x + 60, GetWindowPos( ).y }, { GetWindowPos( ).x + 30, GetWindowPos( ).y }, { GetWindowPos( ).x + 30, GetWindowPos( ).y + GetWindowHeight( ) }, { GetWindowPos( ).x + 50, GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0.03f ) );
-                GetWindowDrawList( )->AddQuadFilled( { GetWindowPos( ).x + 175, GetWindowPos( ).y }, { GetWindowPos( ).x + 130, GetWindowPos( ).y }, { GetWindowPos( ).x + 120, GetWindowPos( ).y + GetWindowHeight( ) }, { GetWindowPos( ).x + 165, GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0.03f ) );
+                g_static_layer.draw( GetWindowDrawList( ), GetID( "##chrome" ), GetWindowPos( ), GetWindowSize( ), [&]( ImDrawList* draw_list ) {
+                    draw_list->AddQuadFilled( { GetWindowPos( ).x + 60, GetWindowPos( ).y }, { GetWindowPos( ).x + 30, GetWindowPos( ).y }, { GetWindowPos( ).x + 30, GetWindowPos( ).y + GetWindowHeight( ) }, { GetWindowPos( ).x + 50, GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0.03f ) );
+                    draw_list->AddQuadFilled( { GetWindowPos( ).x + 175, GetWindowPos( ).y }, { GetWindowPos( ).x + 130, GetWindowPos( ).y }, { GetWindowPos( ).x + 120, GetWindowPos( ).y + GetWindowHeight( ) }, { GetWindowPos( ).x + 165, GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0.03f ) );
 
-                GetWindowDrawList( )->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + GetWindowHeight( ) - 3 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) - 3 }, GetColorU32( ImGuiCol_BorderShadow ) );
-                GetWindowDrawList( )->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + GetWindowHeight( ) - 2 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) - 2 }, GetColorU32( ImGuiCol_Border ) );
-                GetWindowDrawList( )->AddRectFilledMultiColor( { GetWindowPos( ).x + GetWindowWidth( ) / 2, GetWindowPos( ).y + GetWindowHeight( ) - 1 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0 ), GetColorU32( ImGuiCol_Scheme ), GetColorU32( ImGuiCol_Scheme ), GetColorU32( ImGuiCol_Scheme, 0 ) );
+                    draw_list->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + GetWindowHeight( ) - 3 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) - 3 }, GetColorU32( ImGuiCol_BorderShadow ) );
+                    draw_list->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + GetWindowHeight( ) - 2 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) - 2 }, GetColorU32( ImGuiCol_Border ) );
+                    draw_list->AddRectFilledMultiColor( { GetWindowPos( ).x + GetWindowWidth( ) / 2, GetWindowPos( ).y + GetWindowHeight( ) - 1 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + GetWindowHeight( ) }, GetColorU32( ImGuiCol_Scheme, 0 ), GetColorU32( ImGuiCol_Scheme ), GetColorU32( ImGuiCol_Scheme ), GetColorU32( ImGuiCol_Scheme, 0 ) );
+                } );
 
                 add_text( font, Config::FONT_SIZE, { GetWindowPos( ).x + 6, GetWindowPos( ).y + GetWindowHeight( ) / 2 - Config::FONT_SIZE / 2 - 2 }, GetColorU32( ImGuiCol_Scheme ), Config::APP_TITLE.c_str() );
             }
@@ -302,26 +589,47 @@ public:
 
             SetCursorPos({ 2, GetWindowHeight( ) - 24 });
             BeginChild( "footer", { GetWindowWidth( ) - 4, 22 } ); {
-                GetWindowDrawList( )->AddLine( GetWindowPos( ), { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y }, GetColorU32( ImGuiCol_Border ) );
-                GetWindowDrawList( )->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + 1 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + 1 }, GetColorU32( ImGuiCol_BorderShadow ) );
+                g_static_layer.draw( GetWindowDrawList( ), GetID( "##chrome" ), GetWindowPos( ), GetWindowSize( ), [&]( ImDrawList* draw_list ) {
+                    draw_list->AddLine( GetWindowPos( ), { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y }, GetColorU32( ImGuiCol_Border ) );
+                    draw_list->AddLine( { GetWindowPos( ).x, GetWindowPos( ).y + 1 }, { GetWindowPos( ).x + GetWindowWidth( ), GetWindowPos( ).y + 1 }, GetColorU32( ImGuiCol_BorderShadow ) );
+                } );
 
-                // Get current date
+                // Get current date; only reformatted when it rolls over at local midnight
                 time_t now = time(0);
-                tm* ltm = localtime(&now);
-                char date_str[32];
-                strftime(date_str, sizeof(date_str), "%b %d %Y", ltm);
+                if (now >= footer_date_expires) {
+                    tm* ltm = localtime(&now);
+                    strftime(footer_date, sizeof(footer_date), "%b %d %Y", ltm);
+
+                    tm next_day = *ltm;
+                    next_day.tm_mday += 1;
+                    next_day.tm_hour = next_day.tm_min = next_day.tm_sec = 0;
+                    next_day.tm_isdst = -1;
+                    footer_date_expires = mktime(&next_day);
+                }
+                g_scheduler.schedule_in( std::chrono::seconds( ImMax< long long >( 1, ( long long )difftime( footer_date_expires, now ) ) ) );
                 
-                add_text( font, Config::FONT_SIZE, { GetWindowPos( ).x + 6, GetWindowPos( ).y + GetWindowHeight( ) / 2 - Config::FONT_SIZE / 2 - 1 }, GetColorU32( ImGuiCol_TextDisabled ), date_str );
+                add_text( font, Config::FONT_SIZE, { GetWindowPos( ).x + 6, GetWindowPos( ).y + GetWindowHeight( ) / 2 - Config::FONT_SIZE / 2 - 1 }, GetColorU32( ImGuiCol_TextDisabled ), footer_date );
             }
             EndChild( );
         }
         End( );
+
+        // Keep the text caret blinking while a text field has focus; in-flight requests redraw
+        // through the completion hook when they finish, not on a timer
+        if ( GetIO( ).WantTextInput )
+            g_scheduler.schedule_in( std::chrono::milliseconds( 400 ) );
+
+        if ( startup_stats.first_usable_frame_ms < 0.f && keyauth_initialized ) {
+            startup_stats.first_usable_frame_ms = ms_since( created_at );
+        }
     }
 };
 
+#ifdef _WIN32
 class c_frame {
 public:
     c_frame( ) {
+        KEYAUTH_TRACE_SCOPE( "c_frame::begin" );
         if ( init_fonts ) {
             auto& io = GetIO( );
             io.Fonts->Clear( );
@@ -334,7 +642,7 @@ public:
                 }
             }
 
-            ImGuiFreeType::BuildFontAtlas( io.Fonts );
+            font_cache::build( io.Fonts, Config::FONT_PATH, g_font_cache_path );
             ImGui_ImplDX11_CreateDeviceObjects( );
 
             init_fonts = false;
@@ -346,6 +654,7 @@ public:
     }
 
     ~c_frame( ) {
+        KEYAUTH_TRACE_SCOPE( "c_frame::present" );
         Render( );
         const float clear_c[4] = { GetStyleColorVec4( ImGuiCol_WindowBg ).x, GetStyleColorVec4( ImGuiCol_WindowBg ).y, GetStyleColorVec4( ImGuiCol_WindowBg ).z, GetStyleColorVec4( ImGuiCol_WindowBg ).w };
         g_pd3dDeviceContext->OMSetRenderTargets( 1, &g_mainRenderTargetView, nullptr );
@@ -357,15 +666,36 @@ public:
     }
 };
 
+// Blocks until a window message arrives or the scheduler's next deadline passes. The main
+// loop calls this instead of building a frame when g_scheduler.begin_frame( ) returns false:
+//
+//     if ( !g_scheduler.begin_frame( ) ) { wait_for_work( ); continue; }
+//     c_frame frame; main.render( );
+inline void wait_for_work( ) {
+    const auto wait = g_scheduler.time_until_next( );
+    if ( wait == c_render_scheduler::clock::duration::zero( ) )
+        return;
+
+    DWORD timeout = INFINITE;
+    if ( wait != c_render_scheduler::clock::duration::max( ) )
+        timeout = ( DWORD )std::chrono::duration_cast< std::chrono::milliseconds >( wait ).count( ) + 1;
+
+    MsgWaitForMultipleObjectsEx( 0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE );
+}
+
 class c_context {
 public:
     c_context( HWND hwnd ) {
+        // Async completions arrive on other threads; a posted message wakes wait_for_work( )
+        g_scheduler.set_waker( [hwnd]( ) { PostMessageW( hwnd, WM_NULL, 0, 0 ); } );
+
         CreateContext( );
         ImGui_ImplWin32_Init( hwnd );
         ImGui_ImplDX11_Init( g_pd3dDevice, g_pd3dDeviceContext );
     }
 
     ~c_context( ) {
+        g_scheduler.set_waker( nullptr );
         ImGui_ImplDX11_Shutdown( );
         ImGui_ImplWin32_Shutdown( );
         DestroyContext( );
@@ -423,6 +753,11 @@ void CleanupRenderTarget( ) {
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam );
 
 LRESULT WINAPI WndProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam ) {
+    // Anything the user can see or interact with makes the next frame dirty
+    if ( ( msg >= WM_MOUSEFIRST && msg <= WM_MOUSELAST ) || ( msg >= WM_KEYFIRST && msg <= WM_KEYLAST ) ||
+         msg == WM_SIZE || msg == WM_PAINT || msg == WM_SETFOCUS || msg == WM_KILLFOCUS || msg == WM_MOUSELEAVE || msg == WM_SETCURSOR )
+        g_scheduler.invalidate( );
+
     if ( ImGui_ImplWin32_WndProcHandler( hWnd, msg, wParam, lParam ) )
         return true;
 
@@ -443,3 +778,4 @@ LRESULT WINAPI WndProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam ) {
     }
     return ::DefWindowProcW( hWnd, msg, wParam, lParam );
 }
+#endif
\ No newline at end of file
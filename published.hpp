@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// One shared_ptr<const T> that many threads read while a single writer replaces it, with reads
+// that never take a lock. std::atomic_load on a shared_ptr is not that: libstdc++ and MSVC guard
+// it with a mutex from a global pool (std::atomic_is_lock_free reports false).
+//
+// The current value sits behind an atomic raw pointer. A reader claims a hazard slot, announces
+// the pointer it is about to copy there, checks it is still current and copies the shared_ptr
+// (an atomic reference count increment). A replaced value is retired, and only freed once no
+// slot announces it, so a reader never copies from freed memory.
+namespace published {
+    template<class T, size_t Slots = 64>
+    class Value {
+    public:
+        using Ptr = std::shared_ptr<const T>;
+
+        Value() = default;
+        Value(const Value&) = delete;
+        Value& operator=(const Value&) = delete;
+
+        ~Value() {
+            delete head.load();
+            for (const Ptr* node : retired) delete node;
+        }
+
+        // Lock-free: no mutex, and it only waits if every slot is in use at the same moment
+        // (more than Slots threads inside load()), each for the length of one pointer copy
+        Ptr load() const {
+            Slot& slot = claim();
+            const Ptr* node = head.load();
+            for (;;) {
+                slot.hazard.store(node);
+                const Ptr* again = head.load();
+                if (again == node) break;
+                node = again;
+            }
+
+            Ptr value = node ? *node : Ptr();
+            slot.hazard.store(nullptr, std::memory_order_release);
+            slot.claimed.store(false, std::memory_order_release);
+            return value;
+        }
+
+        // Writers must be serialised by the caller. Frees whatever replaced values no reader
+        // is still copying.
+        void store(Ptr value) {
+            const Ptr* old = head.exchange(new Ptr(std::move(value)));
+            if (old) retired.push_back(old);
+            reclaim();
+        }
+
+        static constexpr bool is_lock_free() {
+            return std::atomic<const Ptr*>::is_always_lock_free && std::atomic<bool>::is_always_lock_free;
+        }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<bool> claimed{false};
+            std::atomic<const Ptr*> hazard{nullptr};
+        };
+
+        std::atomic<const Ptr*> head{nullptr};
+        mutable Slot slots[Slots];
+        std::vector<const Ptr*> retired; // writer only
+
+        Slot& claim() const {
+            // Threads start at different slots so they rarely collide
+            static thread_local const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+            for (size_t i = start;; ++i) {
+                Slot& slot = slots[i % Slots];
+                if (!slot.claimed.load(std::memory_order_relaxed) && !slot.claimed.exchange(true, std::memory_order_acquire))
+                    return slot;
+                if ((i - start) % Slots == Slots - 1) std::this_thread::yield();
+            }
+        }
+
+        void reclaim() {
+            const Ptr* in_use[Slots];
+            for (size_t i = 0; i < Slots; ++i) in_use[i] = slots[i].hazard.load();
+
+            size_t kept = 0;
+            for (const Ptr* node : retired) {
+                bool hazardous = false;
+                for (const Ptr* hazard : in_use) hazardous = hazardous || hazard == node;
+                if (hazardous) retired[kept++] = node;
+                else delete node;
+            }
+            retired.resize(kept);
+        }
+    };
+
+    static_assert(Value<int>::is_lock_free(), "published::Value needs lock-free atomic pointers");
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+// Decides whether the next frame needs to be built at all. The window is redrawn only when
+// something made it dirty (input, resize, an async completion) or when a deadline requested
+// by the UI during the previous frame has passed (animation tick, clock rollover, caret blink).
+// Has no D3D/Win32 dependency so the policy can be driven from tests or headless builds.
+class c_render_scheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // ImGui needs a couple of frames after an event to settle hover/active state
+    static constexpr int settle_frames = 3;
+
+    // Marks the UI dirty; safe to call from any thread
+    void invalidate( int frames = settle_frames ) {
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            if ( frames > dirty_frames )
+                dirty_frames = frames;
+        }
+        wake( );
+    }
+
+    // Requests a frame no later than deadline; deadlines only live for the frame that set them
+    void schedule( clock::time_point deadline ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( deadline < next_deadline )
+            next_deadline = deadline;
+    }
+
+    void schedule_in( clock::duration delay ) {
+        schedule( clock::now( ) + delay );
+    }
+
+    // Decides whether to build a frame now; consumes one dirty frame or the expired deadline
+    bool begin_frame( clock::time_point now = clock::now( ) ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( dirty_frames <= 0 && now < next_deadline ) {
+            skipped++;
+            return false;
+        }
+
+        if ( dirty_frames > 0 )
+            dirty_frames--;
+        next_deadline = clock::time_point::max( );
+        rendered++;
+        return true;
+    }
+
+    // How long the caller may sleep before the next frame is due; zero if one is due now
+    clock::duration time_until_next( clock::time_point now = clock::now( ) ) const {
+        std::lock_guard< std::mutex > lock( mutex );
+        if ( dirty_frames > 0 || next_deadline <= now )
+            return clock::duration::zero( );
+        if ( next_deadline == clock::time_point::max( ) )
+            return clock::duration::max( );
+        return next_deadline - now;
+    }
+
+    // Portable blocking wait until dirty or the next deadline; Win32 uses MsgWaitForMultipleObjects instead
+    void wait( ) {
+        std::unique_lock< std::mutex > lock( mutex );
+        while ( dirty_frames <= 0 ) {
+            if ( next_deadline == clock::time_point::max( ) ) {
+                wake_cv.wait( lock );
+            } else if ( wake_cv.wait_until( lock, next_deadline ) == std::cv_status::timeout ) {
+                return;
+            }
+        }
+    }
+
+    // Called whenever the scheduler becomes dirty from another thread, e.g. to post a message
+    void set_waker( std::function< void( ) > fn ) {
+        std::lock_guard< std::mutex > lock( mutex );
+        waker = std::move( fn );
+    }
+
+    unsigned long long frames_rendered( ) const { return rendered; }
+    unsigned long long frames_skipped( ) const { return skipped; }
+
+private:
+    void wake( ) {
+        wake_cv.notify_all( );
+
+        std::function< void( ) > fn;
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            fn = waker;
+        }
+        if ( fn )
+            fn( );
+    }
+
+    mutable std::mutex mutex;
+    std::condition_variable wake_cv;
+    std::function< void( ) > waker;
+
+    int dirty_frames = settle_frames; // the first frames always render
+    clock::time_point next_deadline = clock::time_point::max( );
+
+    std::atomic< unsigned long long > rendered{ 0 };
+    std::atomic< unsigned long long > skipped{ 0 };
+};
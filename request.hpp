@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <iterator>
+
+// Typed form bodies for the KeyAuth API. Each endpoint lists its fields at compile time, so a
+// call site with the wrong number of values does not build, and values are percent-encoded
+// straight into a caller-owned buffer. Once that buffer has grown to fit, building a request
+// performs no heap allocations.
+namespace request {
+    struct Init {
+        static constexpr const char* type = "init";
+        static constexpr const char* fields[] = {"name", "ownerid", "ver"};
+    };
+
+    struct Login {
+        static constexpr const char* type = "login";
+        static constexpr const char* fields[] = {"username", "pass", "hwid", "sessionid"};
+    };
+
+    struct Register {
+        static constexpr const char* type = "register";
+        static constexpr const char* fields[] = {"username", "pass", "key", "hwid", "sessionid"};
+    };
+
+    struct License {
+        static constexpr const char* type = "license";
+        static constexpr const char* fields[] = {"key", "hwid", "sessionid"};
+    };
+
+    struct Check {
+        static constexpr const char* type = "check";
+        static constexpr const char* fields[] = {"sessionid", "name", "ownerid"};
+    };
+
+    // Typical bodies fit without regrowing; longer ones grow the buffer once and keep it
+    static constexpr size_t initial_reserve = 512;
+
+    // application/x-www-form-urlencoded: everything but RFC 3986 unreserved characters is escaped,
+    // so '&', '=' and '+' in a password can't split or alter the form
+    inline void append_encoded(std::string& out, std::string_view value) {
+        static const char hex[] = "0123456789ABCDEF";
+
+        for (unsigned char c : value) {
+            bool unreserved = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                              c == '-' || c == '.' || c == '_' || c == '~';
+            if (unreserved) {
+                out.push_back((char)c);
+            } else {
+                out.push_back('%');
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 0x0F]);
+            }
+        }
+    }
+
+    // Replaces the contents of out with "type=<Endpoint>&field=value..." in schema order
+    template<class Endpoint, class... Values>
+    void encode(std::string& out, const Values&... values) {
+        static_assert(sizeof...(Values) == std::size(Endpoint::fields), "value count must match the endpoint schema");
+
+        out.clear();
+        out += "type=";
+        out += Endpoint::type;
+
+        size_t field = 0;
+        ((out += '&', out += Endpoint::fields[field++], out += '=', append_encoded(out, std::string_view(values))), ...);
+    }
+
+    // Per-thread body buffer reused across calls
+    inline std::string& scratch() {
+        thread_local std::string buffer = [] {
+            std::string reserved;
+            reserved.reserve(initial_reserve);
+            return reserved;
+        }();
+        return buffer;
+    }
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Per-endpoint network metrics for KeyAuth requests.
+//
+// Recording is a handful of relaxed atomic increments into fixed power-of-two buckets, so the
+// network threads never lock or allocate. Readers take a snapshot whenever they like; it may
+// be a few increments out of step across fields, which is fine for diagnostics.
+namespace request_metrics {
+    enum Phase {
+        dns,        // name lookup
+        connect,    // TCP connect after the lookup
+        tls,        // TLS handshake after the connect
+        first_byte, // request sent to first response byte: mostly server time
+        total,
+        phase_count
+    };
+
+    inline const char* const phase_names[phase_count] = {"DNS", "Connect", "TLS", "First byte", "Total"};
+
+    // Bucket i counts durations in [2^(i-1), 2^i) microseconds, bucket 0 anything under 1 us and
+    // the last one everything from ~4.2 s up
+    inline constexpr int bucket_count = 24;
+
+    struct HistogramSnapshot {
+        uint64_t buckets[bucket_count] = {};
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+
+        double mean_ms() const {
+            return count ? sum_us / 1000.0 / count : 0.0;
+        }
+
+        // Upper bound of the bucket holding the p-th percentile (p in 0..1), so at most 2x high
+        double percentile_ms(double p) const {
+            if (!count) return 0.0;
+
+            uint64_t rank = (uint64_t)(p * (count - 1)) + 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < bucket_count; ++i) {
+                seen += buckets[i];
+                if (seen >= rank) return (uint64_t(1) << i) / 1000.0;
+            }
+            return (uint64_t(1) << (bucket_count - 1)) / 1000.0;
+        }
+    };
+
+    class Histogram {
+    public:
+        void record(uint64_t us) {
+            int bucket = 0;
+            while (bucket < bucket_count - 1 && us >= (uint64_t(1) << bucket)) ++bucket;
+
+            buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            sum_us.fetch_add(us, std::memory_order_relaxed);
+        }
+
+        HistogramSnapshot snapshot() const {
+            HistogramSnapshot out;
+            for (int i = 0; i < bucket_count; ++i) {
+                out.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+                out.count += out.buckets[i];
+            }
+            out.sum_us = sum_us.load(std::memory_order_relaxed);
+            return out;
+        }
+
+    private:
+        std::atomic<uint64_t> buckets[bucket_count] = {};
+        std::atomic<uint64_t> sum_us{0};
+    };
+
+    // One finished transfer. Phase times are durations, not libcurl's cumulative offsets;
+    // new_connection says whether dns/connect happened at all, tls whether there was a handshake.
+    struct Sample {
+        uint64_t phase_us[phase_count] = {};
+        bool new_connection = false;
+        bool tls = false;
+        bool transport_error = false; // no HTTP status; status is 0
+        long status = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+    };
+
+    struct EndpointSnapshot {
+        const char* name = "";
+        uint64_t requests = 0;
+        uint64_t transport_errors = 0;
+        uint64_t status_2xx = 0;
+        uint64_t status_4xx = 0;
+        uint64_t status_5xx = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t bytes_received = 0;
+        HistogramSnapshot phases[phase_count];
+    };
+
+    class Endpoint {
+    public:
+        explicit Endpoint(const char* name = "") : name(name) {}
+
+        void record(const Sample& sample) {
+            requests.fetch_add(1, std::memory_order_relaxed);
+
+            if (sample.transport_error) transport_errors.fetch_add(1, std::memory_order_relaxed);
+            else if (sample.status >= 500) status_5xx.fetch_add(1, std::memory_order_relaxed);
+            else if (sample.status >= 400) status_4xx.fetch_add(1, std::memory_order_relaxed);
+            else if (sample.status >= 200 && sample.status < 300) status_2xx.fetch_add(1, std::memory_order_relaxed);
+
+            bytes_sent.fetch_add(sample.bytes_sent, std::memory_order_relaxed);
+            bytes_received.fetch_add(sample.bytes_received, std::memory_order_relaxed);
+
+            // Phases that did not happen are left out rather than recorded as zeros, which would
+            // drown out the real ones: reused connections skip dns/connect/tls, plain HTTP skips
+            // tls and a transfer that failed never saw a first byte
+            for (int phase = 0; phase < phase_count; ++phase) {
+                if (phase < first_byte && !sample.new_connection) continue;
+                if (phase == tls && !sample.tls) continue;
+                if (phase == first_byte && sample.transport_error) continue;
+                phases[phase].record(sample.phase_us[phase]);
+            }
+        }
+
+        EndpointSnapshot snapshot() const {
+            EndpointSnapshot out;
+            out.name = name;
+            out.requests = requests.load(std::memory_order_relaxed);
+            out.transport_errors = transport_errors.load(std::memory_order_relaxed);
+            out.status_2xx = status_2xx.load(std::memory_order_relaxed);
+            out.status_4xx = status_4xx.load(std::memory_order_relaxed);
+            out.status_5xx = status_5xx.load(std::memory_order_relaxed);
+            out.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+            out.bytes_received = bytes_received.load(std::memory_order_relaxed);
+            for (int phase = 0; phase < phase_count; ++phase) out.phases[phase] = phases[phase].snapshot();
+            return out;
+        }
+
+    private:
+        const char* name;
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> transport_errors{0};
+        std::atomic<uint64_t> status_2xx{0};
+        std::atomic<uint64_t> status_4xx{0};
+        std::atomic<uint64_t> status_5xx{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> bytes_received{0};
+        Histogram phases[phase_count];
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <cstdio>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincrypt.h>
+#pragma comment(lib, "crypt32.lib")
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Files holding secrets or values the client later trusts (the session cache, TLS tickets, the
+// HWID cache). On Windows the contents are protected with DPAPI, bound to the current user
+// account and optionally to extra entropy; elsewhere write_private() makes the file readable
+// by its owner only.
+namespace secure_file {
+#ifdef _WIN32
+    inline bool protect(const std::string& plain, const std::string& entropy, const wchar_t* description, std::string& out) {
+        DATA_BLOB input = { (DWORD)plain.size(), (BYTE*)plain.data() };
+        DATA_BLOB extra = { (DWORD)entropy.size(), (BYTE*)entropy.data() };
+        DATA_BLOB output = {};
+
+        if (!CryptProtectData(&input, description, entropy.empty() ? nullptr : &extra, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+            return false;
+        }
+
+        out.assign((const char*)output.pbData, output.cbData);
+        LocalFree(output.pbData);
+        return true;
+    }
+
+    inline bool unprotect(const std::string& blob, const std::string& entropy, std::string& out) {
+        DATA_BLOB input = { (DWORD)blob.size(), (BYTE*)blob.data() };
+        DATA_BLOB extra = { (DWORD)entropy.size(), (BYTE*)entropy.data() };
+        DATA_BLOB output = {};
+
+        if (!CryptUnprotectData(&input, nullptr, entropy.empty() ? nullptr : &extra, nullptr, nullptr, CRYPTPROTECT_UI_FORBIDDEN, &output)) {
+            return false;
+        }
+
+        out.assign((const char*)output.pbData, output.cbData);
+        LocalFree(output.pbData);
+        return true;
+    }
+#endif
+
+    // Replaces the file's contents. On POSIX it is created, or reset to, mode 0600 before anything
+    // is written, so the data is never readable by other users, not even briefly.
+    inline bool write_private(const std::string& path, const std::string& data) {
+#ifdef _WIN32
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(data.data(), data.size());
+        return (bool)file;
+#else
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+
+        bool written = fchmod(fd, 0600) == 0;
+        for (size_t offset = 0; written && offset < data.size();) {
+            ssize_t count = write(fd, data.data() + offset, data.size() - offset);
+            if (count > 0) offset += (size_t)count;
+            else if (count < 0 && errno == EINTR) continue;
+            else written = false;
+        }
+        return close(fd) == 0 && written;
+#endif
+    }
+
+    inline bool read(const std::string& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) return false;
+        out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+}
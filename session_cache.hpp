@@ -0,0 +1,144 @@
+#pragma once
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "keyauth.hpp"
+#include "secure_file.hpp"
+
+// On-disk copy of the last validated KeyAuth session, used to show the logged-in page
+// immediately at startup while the session is revalidated in the background.
+//
+// On Windows the blob is encrypted with DPAPI (bound to the current user account) using the
+// HWID as extra entropy. Other platforms do not encrypt it: the file is only readable by its
+// owner (mode 0600) and obfuscated with an HWID-derived keystream, which keeps the session id
+// out of casual view but stops nobody who can read the file and compute the HWID.
+namespace session_cache {
+    inline const char* const magic = "KASC3";
+
+#ifdef _WIN32
+    inline bool protect(const std::string& plain, const std::string& key, std::string& out) {
+        return secure_file::protect(plain, key, L"KeyAuth session", out);
+    }
+    
+    inline bool unprotect(const std::string& blob, const std::string& key, std::string& out) {
+        return secure_file::unprotect(blob, key, out);
+    }
+#else
+    inline void apply_keystream(std::string& data, const std::string& key) {
+        // FNV-1a of the key seeds an xorshift stream; obfuscation only, not encryption
+        unsigned long long state = 1469598103934665603ULL;
+        for (unsigned char c : key) state = (state ^ c) * 1099511628211ULL;
+        
+        for (auto& c : data) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            c ^= (char)(state & 0xFF);
+        }
+    }
+    
+    inline bool protect(const std::string& plain, const std::string& key, std::string& out) {
+        out = plain;
+        apply_keystream(out, key);
+        return true;
+    }
+    
+    inline bool unprotect(const std::string& blob, const std::string& key, std::string& out) {
+        out = blob;
+        apply_keystream(out, key);
+        return true;
+    }
+#endif
+    
+    inline bool is_expired(const KeyAuth::Session& session) {
+        return session.user.expiry() <= time(nullptr);
+    }
+    
+    inline bool save(const std::string& path, const KeyAuth::Session& session, const std::string& key) {
+        const KeyAuth::UserInfo& user = session.user;
+        
+        // One field per line; the subscription count tells load() how many records follow
+        std::ostringstream stream;
+        stream << magic << "\n" << session.session_id << "\n" << user.username << "\n" << user.ip << "\n" << user.hwid << "\n"
+               << (long long)user.created << "\n" << (long long)user.last_login << "\n" << user.subscriptions.size() << "\n";
+        for (const auto& sub : user.subscriptions) {
+            stream << sub.name << "\n" << sub.key << "\n" << (long long)sub.expiry << "\n" << sub.timeleft << "\n";
+        }
+        
+        // The signed body is raw JSON and may contain newlines, so it goes last with its length
+        const license_token::Token& token = session.token;
+        stream << token.timestamp << "\n" << token.signature << "\n" << token.body.size() << "\n" << token.body;
+        std::string plain = stream.str();
+        
+        std::string blob;
+        if (!protect(plain, key, blob)) return false;
+        return secure_file::write_private(path, blob);
+    }
+    
+    // Lets callers skip fetching the key (the HWID) when there is nothing to load
+    inline bool exists(const std::string& path) {
+        return (bool)std::ifstream(path, std::ios::binary);
+    }
+    
+    // Fails if the file is missing, was written for a different key/user, or has expired
+    inline bool load(const std::string& path, const std::string& key, KeyAuth::Session& session) {
+        std::string blob, plain;
+        if (!secure_file::read(path, blob)) return false;
+        
+        if (!unprotect(blob, key, plain)) return false;
+        
+        std::istringstream stream(plain);
+        std::string header;
+        if (!std::getline(stream, header) || header != magic) return false;
+        
+        auto read_int = [&](long long& value) {
+            std::string line;
+            if (!std::getline(stream, line)) return false;
+            value = std::strtoll(line.c_str(), nullptr, 10);
+            return true;
+        };
+        
+        KeyAuth::Session loaded;
+        KeyAuth::UserInfo& user = loaded.user;
+        long long created = 0, last_login = 0, count = 0;
+        if (!std::getline(stream, loaded.session_id) || !std::getline(stream, user.username) ||
+            !std::getline(stream, user.ip) || !std::getline(stream, user.hwid) ||
+            !read_int(created) || !read_int(last_login) || !read_int(count) || count < 0 || count > 64) {
+            return false;
+        }
+        user.created = (time_t)created;
+        user.last_login = (time_t)last_login;
+        
+        for (long long i = 0; i < count; ++i) {
+            KeyAuth::Subscription sub;
+            long long expiry = 0;
+            if (!std::getline(stream, sub.name) || !std::getline(stream, sub.key) || !read_int(expiry) || !read_int(sub.timeleft)) {
+                return false;
+            }
+            sub.expiry = (time_t)expiry;
+            user.subscriptions.push_back(std::move(sub));
+        }
+        
+        long long body_size = 0;
+        license_token::Token& token = loaded.token;
+        if (!std::getline(stream, token.timestamp) || !std::getline(stream, token.signature) || !read_int(body_size) ||
+            body_size < 0 || body_size > (long long)plain.size()) {
+            return false;
+        }
+        token.body.resize((size_t)body_size);
+        if (!stream.read(&token.body[0], body_size)) return false;
+        
+        if (loaded.session_id.empty() || is_expired(loaded)) return false;
+        
+        session = loaded;
+        return true;
+    }
+    
+    inline void clear(const std::string& path) {
+        std::remove(path.c_str());
+    }
+}
\ No newline at end of file
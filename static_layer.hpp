@@ -0,0 +1,151 @@
+#pragma once
+#include "imgui/imgui.h"
+#include "imgui/imgui_internal.h"
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+
+// Retained geometry for draw calls that only change with the window: borders, header quads,
+// separators and gradients. A layer's build callback tessellates into a private draw list once;
+// later frames copy the cached vertices/indices straight into the window's draw list, moved to
+// the window's current position. The cache is rebuilt when the layer's size, the style colors
+// or alpha, the draw list's anti-aliasing flags or the font atlas' white pixel change.
+//
+// The callback may only add geometry: clip rects or textures it pushes are not kept.
+class c_static_layer {
+public:
+    struct frame_stats_t {
+        unsigned int layers = 0;
+        unsigned int rebuilds = 0;
+        unsigned int vertices_built = 0;  // tessellated this frame
+        unsigned int vertices_cached = 0; // copied from the cache instead
+    };
+
+    // Call once per frame before any draws
+    void new_frame( ) {
+        last_frame = current_frame;
+        current_frame = {};
+    }
+
+    frame_stats_t get_last_frame_stats( ) const {
+        return last_frame;
+    }
+
+    // Off: every draw( ) runs build straight into the draw list, as if there were no layer. For
+    // measuring what the cache saves (frame_bench --static-layer=off).
+    void set_enabled( bool value ) {
+        enabled = value;
+    }
+
+    // Draws what build( draw_list ) adds, at origin. build sees the window as it is now and draws
+    // in absolute coordinates; the result is stored relative to origin.
+    template< class build_t >
+    void draw( ImDrawList* draw_list, ImGuiID id, ImVec2 origin, ImVec2 size, build_t&& build ) {
+        current_frame.layers++;
+        if ( !enabled ) {
+            const int first_vertex = draw_list->VtxBuffer.Size;
+            build( draw_list );
+            current_frame.vertices_built += ( unsigned int )( draw_list->VtxBuffer.Size - first_vertex );
+            return;
+        }
+
+        layer_t& layer = layers[id];
+
+        if ( !layer.valid || !matches( layer, draw_list, size ) ) {
+            rebuild( layer, draw_list, origin, size, build );
+            current_frame.rebuilds++;
+            current_frame.vertices_built += ( unsigned int )layer.vertices.size( );
+        } else {
+            current_frame.vertices_cached += ( unsigned int )layer.vertices.size( );
+        }
+
+        splice( layer, draw_list, origin );
+    }
+
+    // Forgets every layer, e.g. after the device and font atlas were recreated
+    void clear( ) {
+        layers.clear( );
+    }
+
+private:
+    struct layer_t {
+        bool valid = false;
+        ImVec2 size;
+        ImVec4 colors[ImGuiCol_COUNT];
+        float alpha = 0.f;
+        ImDrawListFlags flags = 0;
+        float fringe_scale = 0.f;
+        ImVec2 white_pixel;
+        std::vector< ImDrawVert > vertices; // relative to the origin at build time
+        std::vector< ImDrawIdx > indices;   // relative to the first vertex
+    };
+
+    std::unordered_map< ImGuiID, layer_t > layers;
+    ImDrawList scratch{ nullptr };
+    bool enabled = true;
+
+    frame_stats_t current_frame;
+    frame_stats_t last_frame;
+
+    static bool matches( const layer_t& layer, const ImDrawList* draw_list, ImVec2 size ) {
+        const ImGuiStyle& style = ImGui::GetStyle( );
+        return layer.size.x == size.x && layer.size.y == size.y && layer.alpha == style.Alpha &&
+               layer.flags == draw_list->Flags && layer.fringe_scale == draw_list->_FringeScale &&
+               layer.white_pixel.x == draw_list->_Data->TexUvWhitePixel.x && layer.white_pixel.y == draw_list->_Data->TexUvWhitePixel.y &&
+               memcmp( layer.colors, style.Colors, sizeof( layer.colors ) ) == 0;
+    }
+
+    template< class build_t >
+    void rebuild( layer_t& layer, const ImDrawList* draw_list, ImVec2 origin, ImVec2 size, build_t& build ) {
+        const ImGuiStyle& style = ImGui::GetStyle( );
+
+        // Same shared data and flags as the target, so the tessellation is identical to drawing there
+        scratch._Data = draw_list->_Data;
+        scratch._ResetForNewFrame( );
+        scratch.Flags = draw_list->Flags;
+        scratch._FringeScale = draw_list->_FringeScale;
+        scratch.PushClipRectFullScreen( );
+
+        build( &scratch );
+
+        layer.vertices.assign( scratch.VtxBuffer.Data, scratch.VtxBuffer.Data + scratch.VtxBuffer.Size );
+        layer.indices.assign( scratch.IdxBuffer.Data, scratch.IdxBuffer.Data + scratch.IdxBuffer.Size );
+        for ( auto& vertex : layer.vertices ) {
+            vertex.pos.x -= origin.x;
+            vertex.pos.y -= origin.y;
+        }
+
+        layer.valid = true;
+        layer.size = size;
+        layer.alpha = style.Alpha;
+        layer.flags = draw_list->Flags;
+        layer.fringe_scale = draw_list->_FringeScale;
+        layer.white_pixel = draw_list->_Data->TexUvWhitePixel;
+        memcpy( layer.colors, style.Colors, sizeof( layer.colors ) );
+    }
+
+    // Appends the cached geometry to the draw list's current command, like the Prim* helpers do
+    static void splice( const layer_t& layer, ImDrawList* draw_list, ImVec2 origin ) {
+        if ( layer.indices.empty( ) )
+            return;
+
+        draw_list->PrimReserve( ( int )layer.indices.size( ), ( int )layer.vertices.size( ) );
+        const unsigned int base = draw_list->_VtxCurrentIdx; // read after PrimReserve, which may start a new vertex offset
+
+        ImDrawVert* vertex_out = draw_list->_VtxWritePtr;
+        for ( const auto& vertex : layer.vertices ) {
+            *vertex_out = vertex;
+            vertex_out->pos.x += origin.x;
+            vertex_out->pos.y += origin.y;
+            ++vertex_out;
+        }
+
+        ImDrawIdx* index_out = draw_list->_IdxWritePtr;
+        for ( ImDrawIdx index : layer.indices )
+            *index_out++ = ( ImDrawIdx )( base + index );
+
+        draw_list->_VtxWritePtr = vertex_out;
+        draw_list->_IdxWritePtr = index_out;
+        draw_list->_VtxCurrentIdx += ( unsigned int )layer.vertices.size( );
+    }
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Counts every operator new in the process, and separately on the calling thread. Replaces the
+// global allocation functions, so include it in exactly one translation unit per executable.
+namespace alloc_count {
+    inline std::atomic<unsigned long long> process_total{0};
+    inline thread_local unsigned long long thread_total = 0;
+
+    inline unsigned long long total() {
+        return process_total.load(std::memory_order_relaxed);
+    }
+
+    inline unsigned long long this_thread() {
+        return thread_total;
+    }
+
+    inline void* allocate(std::size_t size, std::size_t alignment = 0) {
+        process_total.fetch_add(1, std::memory_order_relaxed);
+        thread_total++;
+        if (size == 0) size = 1;
+        if (alignment) return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+        return std::malloc(size);
+    }
+}
+
+void* operator new(std::size_t size) {
+    if (void* p = alloc_count::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = alloc_count::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = alloc_count::allocate(size, (std::size_t)alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = alloc_count::allocate(size, (std::size_t)alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return alloc_count::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return alloc_count::allocate(size);
+}
+
+// Everything above came from malloc or aligned_alloc, so free() is the right release. GCC 11+
+// cannot see that through allocate() and flags each free() under -Wall (-Wmismatched-new-delete).
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 11)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 11)
+#pragma GCC diagnostic pop
+#endif
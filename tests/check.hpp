@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Assertions for the test executables. A failed CHECK prints where and why and exits non-zero,
+// which is all ctest looks at; unlike assert() it stays on in release builds.
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+            std::exit(1);                                                                   \
+        }                                                                                   \
+    } while (0)
+
+namespace check {
+    inline double ms_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Runs one named case and reports how long it took
+    template<class Test>
+    void run(const char* name, Test test) {
+        const auto start = std::chrono::steady_clock::now();
+        test();
+        printf("[ok] %s (%.0f ms)\n", name, ms_since(start));
+        fflush(stdout);
+    }
+}
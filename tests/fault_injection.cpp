@@ -0,0 +1,222 @@
+// Retry, deadline, circuit breaker and hedging behaviour against a local server that fails
+// on cue. Each case gets its own server, so per-path request counts start at zero.
+#include "keyauth.hpp"
+#include "check.hpp"
+#include "mock_server.hpp"
+
+using namespace std::chrono;
+
+namespace {
+    // Answers like the API once the first `failures` requests have been refused with status
+    mock::Handler failing_first(unsigned long failures, int status = 503) {
+        return [failures, status](const mock::Request& request, mock::Reply& reply) {
+            if (request.count <= failures) reply.status = status;
+            else mock::keyauth_api(request, reply);
+        };
+    }
+
+    KeyAuth::CallPolicy policy() {
+        KeyAuth::CallPolicy policy;
+        policy.backoff_base = milliseconds(20);
+        policy.rate_per_second = 0.0;
+        return policy;
+    }
+
+    void retries_recover_flaky_init() {
+        mock::Server server(failing_first(2));
+        KeyAuth client("app", "secret", "1.0", server.url());
+        client.set_call_policy(policy());
+
+        CHECK(client.init());
+        CHECK(client.get_call_stats().retries == 2);
+        CHECK(server.requests("/") == 3);
+
+        mock::Server async_server(failing_first(2));
+        KeyAuth async_client("app", "secret", "1.0", async_server.url());
+        async_client.set_call_policy(policy());
+
+        CHECK(async_client.init_async().get());
+        CHECK(async_client.get_call_stats().retries == 2);
+    }
+
+    void dropped_connection_is_retried() {
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            reply.drop = request.count == 1;
+            mock::keyauth_api(request, reply);
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        client.set_call_policy(policy());
+
+        CHECK(client.init());
+        CHECK(client.get_call_stats().retries == 1);
+    }
+
+    void login_is_sent_once() {
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            if (transport::param(request.body, "type") == "login") reply.status = 503;
+            else mock::keyauth_api(request, reply);
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        client.set_call_policy(policy());
+        CHECK(client.init());
+
+        CHECK(!client.login("user", "pass").success);
+        CHECK(!client.login_async("user", "other").get().success);
+        CHECK(server.requests("/") == 3);
+        CHECK(client.get_call_stats().retries == 0);
+    }
+
+    void deadline_bounds_a_hanging_server() {
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            reply.delay = seconds(3);
+            mock::keyauth_api(request, reply);
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        KeyAuth::CallPolicy budget = policy();
+        budget.deadline = milliseconds(500);
+        client.set_call_policy(budget);
+
+        auto start = steady_clock::now();
+        CHECK(!client.init());
+        CHECK(check::ms_since(start) < 900);
+        CHECK(client.get_call_stats().timeouts >= 1);
+
+        start = steady_clock::now();
+        CHECK(!client.init_async().get());
+        CHECK(check::ms_since(start) < 900);
+    }
+
+    void breaker_opens_and_recovers() {
+        std::atomic<bool> down{true};
+        mock::Server server([&down](const mock::Request& request, mock::Reply& reply) {
+            if (down) reply.status = 503;
+            else mock::keyauth_api(request, reply);
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        KeyAuth::CallPolicy breaker = policy();
+        breaker.max_attempts = 1;
+        breaker.breaker_threshold = 3;
+        breaker.breaker_cooldown = milliseconds(300);
+        client.set_call_policy(breaker);
+
+        for (int i = 0; i < 3; ++i) CHECK(!client.init());
+        CHECK(client.get_call_stats().circuit_open);
+
+        // Open: refused without touching the network
+        const unsigned long sent = server.requests("/");
+        const auto start = steady_clock::now();
+        CHECK(!client.init());
+        CHECK(!client.init_async().get());
+        CHECK(check::ms_since(start) < 50);
+        CHECK(server.requests("/") == sent);
+        CHECK(client.get_call_stats().rejected == 2);
+
+        // The probe after the cooldown finds the server back and closes the breaker
+        down = false;
+        for (int i = 0; i < 50 && client.get_call_stats().circuit_open; ++i) std::this_thread::sleep_for(milliseconds(20));
+        CHECK(!client.get_call_stats().circuit_open);
+        CHECK(client.init());
+    }
+
+    void breaker_probe_keeps_probing_while_down() {
+        mock::Server server(failing_first(6));
+        KeyAuth client("app", "secret", "1.0", server.url());
+        KeyAuth::CallPolicy breaker = policy();
+        breaker.max_attempts = 1;
+        breaker.breaker_threshold = 3;
+        breaker.breaker_cooldown = milliseconds(100);
+        client.set_call_policy(breaker);
+
+        for (int i = 0; i < 3; ++i) CHECK(!client.init());
+        CHECK(client.get_call_stats().circuit_open);
+
+        // Three failed probes reopen it each time; the fourth gets through
+        for (int i = 0; i < 100 && client.get_call_stats().circuit_open; ++i) std::this_thread::sleep_for(milliseconds(20));
+        CHECK(!client.get_call_stats().circuit_open);
+        CHECK(server.requests("/") == 7);
+    }
+
+    void hedge_wins_over_a_slow_reply() {
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            if (request.count == 21) reply.delay = seconds(2);
+            mock::keyauth_api(request, reply);
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        KeyAuth::CallPolicy hedged = policy();
+        hedged.hedge = true;
+        client.set_call_policy(hedged);
+
+        // Enough fast samples for a p95 to hedge after
+        for (int i = 0; i < 20; ++i) CHECK(client.init_async().get());
+
+        const auto start = steady_clock::now();
+        CHECK(client.init_async().get());
+        CHECK(check::ms_since(start) < 1000);
+        const auto stats = client.get_call_stats();
+        CHECK(stats.hedges == 1);
+        CHECK(stats.hedge_wins == 1);
+    }
+
+    void transfers_in_flight_all_fall_back() {
+        // Claims gzip to clients that offer it and sends plain JSON, which libcurl fails with
+        // CURLE_BAD_CONTENT_ENCODING; compatible mode offers no encoding and reads it fine
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            mock::keyauth_api(request, reply);
+            if (!request.accept_encoding.empty()) {
+                reply.delay = milliseconds(100); // so both transfers fail while in flight together
+                reply.headers = "Content-Encoding: gzip\r\n";
+            }
+        });
+        KeyAuth client("app", "secret", "1.0", server.url());
+        client.set_call_policy(policy());
+        client.restore_session({ "mock", {}, {} });
+
+        // Different bodies, so single-flight does not merge them
+        auto init = client.init_async();
+        auto check = client.check_status_async();
+        CHECK(init.get());
+        CHECK(check.get() == KeyAuth::CheckStatus::valid);
+
+        const auto stats = client.get_connection_stats();
+        CHECK(stats.transport_fallbacks == 1);
+        CHECK(stats.transport == KeyAuth::TransportMode::compatible);
+        CHECK(client.get_call_stats().retries == 0);
+        CHECK(server.requests("/") == 4);
+    }
+
+    void shutdown_fails_calls_in_flight() {
+        mock::Server server([](const mock::Request& request, mock::Reply& reply) {
+            reply.delay = seconds(5);
+            mock::keyauth_api(request, reply);
+        });
+
+        std::future<bool> pending;
+        const auto start = steady_clock::now();
+        {
+            KeyAuth client("app", "secret", "1.0", server.url());
+            client.set_call_policy(policy());
+            pending = client.init_async();
+            std::this_thread::sleep_for(milliseconds(100));
+        }
+        CHECK(pending.wait_for(seconds(0)) == std::future_status::ready);
+        CHECK(!pending.get());
+        CHECK(check::ms_since(start) < 1000);
+    }
+}
+
+int main() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    check::run("retries recover a flaky init", retries_recover_flaky_init);
+    check::run("a dropped connection is retried", dropped_connection_is_retried);
+    check::run("login is sent once", login_is_sent_once);
+    check::run("the deadline bounds a hanging server", deadline_bounds_a_hanging_server);
+    check::run("the breaker opens and recovers", breaker_opens_and_recovers);
+    check::run("the breaker keeps probing while down", breaker_probe_keeps_probing_while_down);
+    check::run("a hedge wins over a slow reply", hedge_wins_over_a_slow_reply);
+    check::run("transfers in flight all fall back", transfers_in_flight_all_fall_back);
+    check::run("shutdown fails calls in flight", shutdown_fails_calls_in_flight);
+
+    curl_global_cleanup();
+    return 0;
+}
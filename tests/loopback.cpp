@@ -0,0 +1,236 @@
+// The auth flow on transport::keyauth_loopback(): no sockets and no TLS, so these cover the
+// client's own logic (session state, the rate limiter, the heartbeat, single-flight) exactly.
+// Also built with KEYAUTH_TRACE as loopback_traced, which checks the trace those calls leave.
+#include "keyauth.hpp"
+#include "check.hpp"
+
+using namespace std::chrono;
+
+namespace {
+    KeyAuth::CallPolicy unlimited() {
+        KeyAuth::CallPolicy policy;
+        policy.rate_per_second = 0.0;
+        return policy;
+    }
+
+    // Polls until done() or the timeout; returns done()
+    template<class Done>
+    bool wait_until(Done done, milliseconds timeout = seconds(5)) {
+        const auto until = steady_clock::now() + timeout;
+        while (!done() && steady_clock::now() < until) std::this_thread::sleep_for(milliseconds(2));
+        return done();
+    }
+
+    void login_round_trip() {
+        auto server = transport::keyauth_loopback("session-1");
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        client.set_call_policy(unlimited());
+
+        CHECK(!client.login("user", "pass").success); // not initialised yet
+        CHECK(server->requests("login") == 0);
+
+        CHECK(client.init());
+        CHECK(client.get_session_id() == "session-1");
+
+        const auto result = client.login("someone", "p&ss=word");
+        CHECK(result.success);
+        CHECK(result.value.username == "someone");
+        CHECK(result.value.hwid == client.get_hwid());
+        CHECK(result.value.subscriptions.size() == 1);
+        CHECK(client.is_logged_in());
+        CHECK(client.get_username() == "someone");
+
+        const auto license = client.license_login_async("KEY-1").get();
+        CHECK(license.success);
+        CHECK(client.get_username() == "KEY-1");
+        CHECK(server->requests("login") == 1);
+        CHECK(server->requests("license") == 1);
+
+        CHECK(client.check());
+        client.logout();
+        CHECK(!client.is_logged_in());
+    }
+
+    void rate_limiter_throttles_bursts() {
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        KeyAuth::CallPolicy policy;
+        policy.rate_per_second = 1.0;
+        policy.rate_burst = 2.0;
+        client.set_call_policy(policy);
+
+        CHECK(client.init());
+        CHECK(client.init());
+        CHECK(!client.init());
+        CHECK(!client.init_async().get());
+        CHECK(client.get_call_stats().throttled == 2);
+        CHECK(server->requests("init") == 2);
+
+        // Other endpoints have their own bucket
+        CHECK(client.login("user", "pass").success);
+    }
+
+    void heartbeat_invalidates_a_rejected_session() {
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        client.set_call_policy(unlimited());
+
+        std::atomic<int> completions{0};
+        client.set_completion_hook([&completions] { completions++; });
+
+        // A session the server no longer knows, as restored from a stale cache
+        KeyAuth::Session saved;
+        saved.session_id = "expired-elsewhere";
+        saved.user.username = "someone";
+        saved.user.subscriptions = {{"default", "", time(nullptr) + 3600, 0}};
+        client.restore_session(saved);
+        CHECK(client.is_logged_in());
+
+        client.start_heartbeat(milliseconds(20), true);
+        CHECK(wait_until([&] { return client.session()->state == KeyAuth::SessionSnapshot::State::invalidated; }));
+
+        const auto session = client.session();
+        CHECK(!session->active());
+        CHECK(!session->reason.empty());
+        CHECK(client.get_heartbeat_stats().invalidations == 1);
+        CHECK(completions > 0);
+
+        // An ended session is not checked again
+        const unsigned long checks = server->requests("check");
+        std::this_thread::sleep_for(milliseconds(100));
+        CHECK(server->requests("check") == checks);
+    }
+
+    void heartbeat_keeps_a_valid_session() {
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        client.set_call_policy(unlimited());
+        CHECK(client.init());
+        CHECK(client.login("someone", "pass").success);
+
+        client.start_heartbeat(milliseconds(10), true);
+        CHECK(wait_until([&] { return client.get_heartbeat_stats().beats >= 3; }));
+        client.stop_heartbeat();
+        CHECK(client.is_logged_in());
+        CHECK(client.get_heartbeat_stats().invalidations == 0);
+    }
+
+    void identical_calls_share_one_request() {
+        constexpr int callers = 8;
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        client.set_call_policy(unlimited());
+
+        // Hold the first init until every other caller has joined its flight
+        server->on("init", [&client](const transport::Request&, transport::Response& response) {
+            wait_until([&] { return client.get_call_stats().coalesced == callers - 1; });
+            response.response_code = 200;
+            response.data = "{\"success\":true,\"message\":\"Initialized\",\"sessionid\":\"shared\"}";
+        });
+
+        std::atomic<int> succeeded{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < callers; ++i) {
+            threads.emplace_back([&] {
+                if (client.init()) succeeded++;
+            });
+        }
+        for (auto& thread : threads) thread.join();
+
+        CHECK(succeeded == callers);
+        CHECK(server->requests("init") == 1);
+        CHECK(client.get_call_stats().coalesced == callers - 1);
+        CHECK(client.get_session_id() == "shared");
+
+        // Different bodies are separate requests
+        CHECK(client.login_async("a", "pass").get().success);
+        CHECK(client.login_async("b", "pass").get().success);
+        CHECK(server->requests("login") == 2);
+    }
+
+#ifdef KEYAUTH_TRACE
+    struct Span {
+        std::string name;
+        std::string detail;
+    };
+
+    // The exported trace is Chrome JSON: complete events with a name, thread, start and
+    // duration, plus metadata naming threads
+    std::vector<Span> parse_trace(const std::string& json, std::vector<std::string>& thread_names) {
+        decoder::Document trace;
+        CHECK(trace.parse(json));
+        CHECK(trace["traceEvents"].size() > 0);
+
+        std::vector<Span> spans;
+        trace["traceEvents"].each([&](const decoder::Value& event) {
+            const std::string phase = event["ph"].as_string();
+            CHECK(phase == "X" || phase == "M");
+            CHECK(event["pid"].as_int() == 1 && event["tid"].as_int() > 0);
+            if (phase == "M") {
+                CHECK(event["name"].as_string() == "thread_name");
+                thread_names.push_back(event["args"]["name"].as_string());
+                return;
+            }
+            CHECK(!event["name"].as_string().empty());
+            CHECK(strtod(event["ts"].as_string().c_str(), nullptr) >= 0.0);
+            CHECK(strtod(event["dur"].as_string().c_str(), nullptr) >= 0.0);
+            spans.push_back({event["name"].as_string(), event["args"]["detail"].as_string()});
+        });
+        return spans;
+    }
+
+    void trace_holds_the_request_spans() {
+        auto server = transport::keyauth_loopback("traced");
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        client.set_call_policy(unlimited());
+
+        CHECK(client.init());
+        CHECK(client.login("someone", "pass").success);
+        CHECK(client.check_async().get());
+
+        char path[] = "/tmp/keyauth_trace_XXXXXX";
+        const int fd = mkstemp(path);
+        CHECK(fd >= 0);
+        close(fd);
+        CHECK(trace::write(path));
+
+        std::string json;
+        FILE* file = fopen(path, "rb");
+        CHECK(file);
+        char buffer[4096];
+        for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) > 0;) json.append(buffer, n);
+        fclose(file);
+        std::remove(path);
+
+        std::vector<std::string> thread_names;
+        const std::vector<Span> spans = parse_trace(json, thread_names);
+        auto has = [&](const char* name, const char* detail) {
+            return std::any_of(spans.begin(), spans.end(), [&](const Span& span) { return span.name == name && span.detail == detail; });
+        };
+
+        // Blocking calls, their decoding, and the async check on the network thread
+        CHECK(has("KeyAuth::init", ""));
+        CHECK(has("KeyAuth::make_request", "init"));
+        CHECK(has("KeyAuth::make_request", "login"));
+        CHECK(has("KeyAuth::decode_response", ""));
+        CHECK(has("transfer", "check"));
+        CHECK(std::find(thread_names.begin(), thread_names.end(), "network") != thread_names.end());
+    }
+#endif
+}
+
+int main() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    check::run("login round trip", login_round_trip);
+    check::run("the rate limiter throttles bursts", rate_limiter_throttles_bursts);
+    check::run("the heartbeat invalidates a rejected session", heartbeat_invalidates_a_rejected_session);
+    check::run("the heartbeat keeps a valid session", heartbeat_keeps_a_valid_session);
+    check::run("identical calls share one request", identical_calls_share_one_request);
+#ifdef KEYAUTH_TRACE
+    check::run("the trace holds the request spans", trace_holds_the_request_spans);
+#endif
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,278 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <cstdint>
+
+// The protocol pieces mock::Server needs to answer HTTP/2 (RFC 9113) on its own: frame headers,
+// an HPACK (RFC 7541) decoder for request headers and an encoder for the few response headers
+// it sends. Enough for libcurl as a client, not a general implementation: no server push, no
+// priorities, and responses never use the dynamic table or Huffman coding.
+namespace mock::http2 {
+    inline constexpr std::string_view preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+    enum FrameType : uint8_t {
+        DATA = 0x0, HEADERS = 0x1, PRIORITY = 0x2, RST_STREAM = 0x3, SETTINGS = 0x4,
+        PUSH_PROMISE = 0x5, PING = 0x6, GOAWAY = 0x7, WINDOW_UPDATE = 0x8, CONTINUATION = 0x9
+    };
+
+    enum Flags : uint8_t {
+        END_STREAM = 0x1, ACK = 0x1, END_HEADERS = 0x4, PADDED = 0x8, PRIORITY_FLAG = 0x20
+    };
+
+    enum Setting : uint16_t {
+        HEADER_TABLE_SIZE = 0x1, INITIAL_WINDOW_SIZE = 0x4, MAX_FRAME_SIZE = 0x5
+    };
+
+    inline constexpr uint32_t default_window = 65535;
+    inline constexpr uint32_t default_frame_size = 16384;
+
+    struct Frame {
+        uint8_t type = 0;
+        uint8_t flags = 0;
+        uint32_t stream = 0;
+        std::string payload;
+    };
+
+    inline uint32_t read32(const char* p) {
+        return (uint32_t)(uint8_t)p[0] << 24 | (uint32_t)(uint8_t)p[1] << 16 | (uint32_t)(uint8_t)p[2] << 8 | (uint8_t)p[3];
+    }
+
+    // 9-byte frame header followed by the payload
+    inline void append_frame(std::string& out, uint8_t type, uint8_t flags, uint32_t stream, std::string_view payload) {
+        const size_t length = payload.size();
+        const char header[9] = { (char)(length >> 16), (char)(length >> 8), (char)length, (char)type, (char)flags,
+                                 (char)(stream >> 24 & 0x7F), (char)(stream >> 16), (char)(stream >> 8), (char)stream };
+        out.append(header, sizeof(header));
+        out.append(payload);
+    }
+
+    inline std::string u32(uint32_t value) {
+        return { (char)(value >> 24), (char)(value >> 16), (char)(value >> 8), (char)value };
+    }
+
+    // Static table, RFC 7541 appendix A; index 0 is unused
+    inline constexpr std::pair<std::string_view, std::string_view> static_table[] = {
+        {"", ""}, {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+        {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+        {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+        {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+        {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+        {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+        {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""},
+        {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+        {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+        {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+        {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+        {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+        {"www-authenticate", ""},
+    };
+    inline constexpr size_t static_entries = sizeof(static_table) / sizeof(static_table[0]) - 1;
+
+    // The HPACK Huffman code is canonical, so the code length of every symbol (RFC 7541
+    // appendix B, EOS last) is all it takes to decode it
+    inline bool huffman_decode(std::string_view in, std::string& out) {
+        static constexpr uint8_t lengths[257] = {
+            13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+            6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+            13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+            15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5, 6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+            20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23, 24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+            22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23, 21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+            26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25, 19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+            20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23, 26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+            30,
+        };
+
+        // Symbols per code length, and all symbols ordered by (length, symbol)
+        struct Table {
+            uint16_t count[31] = {};
+            uint16_t symbols[257] = {};
+
+            Table() {
+                for (uint8_t length : lengths) count[length]++;
+                uint16_t offset[31] = {};
+                for (int length = 1; length < 30; ++length) offset[length + 1] = offset[length] + count[length];
+                for (uint16_t symbol = 0; symbol < 257; ++symbol) symbols[offset[lengths[symbol]]++] = symbol;
+            }
+        };
+        static const Table table;
+
+        uint32_t code = 0, first = 0, index = 0;
+        int length = 0;
+        for (unsigned char byte : in) {
+            for (int bit = 7; bit >= 0; --bit) {
+                code |= (byte >> bit) & 1;
+                ++length;
+                const uint32_t count = table.count[length];
+                if (code - first < count) {
+                    const uint16_t symbol = table.symbols[index + code - first];
+                    if (symbol == 256) return false; // EOS inside a string is an error
+                    out += (char)symbol;
+                    code = first = index = 0;
+                    length = 0;
+                    continue;
+                }
+                if (length == 30) return false;
+                index += count;
+                first = (first + count) << 1;
+                code <<= 1;
+            }
+        }
+        // Only up to 7 bits of EOS padding may be left over
+        return length < 8;
+    }
+
+    // Integer with an n-bit prefix; the prefix bits are the low bits of in[pos]
+    inline bool decode_integer(std::string_view in, size_t& pos, int prefix, uint64_t& value) {
+        if (pos >= in.size()) return false;
+        const uint64_t max = (1u << prefix) - 1;
+        value = (unsigned char)in[pos++] & max;
+        if (value < max) return true;
+
+        for (int shift = 0; pos < in.size() && shift < 56; shift += 7) {
+            const unsigned char byte = (unsigned char)in[pos++];
+            value += (uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    inline void encode_integer(std::string& out, uint8_t high_bits, int prefix, uint64_t value) {
+        const uint64_t max = (1u << prefix) - 1;
+        if (value < max) {
+            out += (char)(high_bits | value);
+            return;
+        }
+        out += (char)(high_bits | max);
+        for (value -= max; value >= 0x80; value >>= 7) out += (char)(0x80 | (value & 0x7F));
+        out += (char)value;
+    }
+
+    inline bool decode_string(std::string_view in, size_t& pos, std::string& out) {
+        if (pos >= in.size()) return false;
+        const bool huffman = (unsigned char)in[pos] & 0x80;
+        uint64_t length;
+        if (!decode_integer(in, pos, 7, length) || length > in.size() - pos) return false;
+
+        const std::string_view raw = in.substr(pos, (size_t)length);
+        pos += (size_t)length;
+        out.clear();
+        if (huffman) return huffman_decode(raw, out);
+        out.assign(raw);
+        return true;
+    }
+
+    // Literal string, never Huffman-coded
+    inline void encode_string(std::string& out, std::string_view text) {
+        encode_integer(out, 0x00, 7, text.size());
+        out += text;
+    }
+
+    // One decoder per connection: the dynamic table lives as long as the connection
+    class HeaderDecoder {
+    public:
+        using Field = std::pair<std::string, std::string>;
+
+        bool decode(std::string_view block, std::vector<Field>& fields) {
+            for (size_t pos = 0; pos < block.size();) {
+                const unsigned char first = (unsigned char)block[pos];
+                uint64_t index;
+
+                if (first & 0x80) { // indexed field
+                    Field field;
+                    if (!decode_integer(block, pos, 7, index) || !lookup(index, field)) return false;
+                    fields.push_back(std::move(field));
+                    continue;
+                }
+
+                if ((first & 0xE0) == 0x20) { // dynamic table size update
+                    uint64_t size;
+                    if (!decode_integer(block, pos, 5, size) || size > 4096) return false;
+                    max_size = (size_t)size;
+                    evict(0);
+                    continue;
+                }
+
+                // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+                const bool indexing = (first & 0xC0) == 0x40;
+                if (!decode_integer(block, pos, indexing ? 6 : 4, index)) return false;
+
+                Field field;
+                if (index) {
+                    Field named;
+                    if (!lookup(index, named)) return false;
+                    field.first = std::move(named.first);
+                } else if (!decode_string(block, pos, field.first)) {
+                    return false;
+                }
+                if (!decode_string(block, pos, field.second)) return false;
+
+                if (indexing) insert(field);
+                fields.push_back(std::move(field));
+            }
+            return true;
+        }
+
+    private:
+        std::deque<Field> dynamic; // newest first
+        size_t size = 0;
+        size_t max_size = 4096;
+
+        static size_t entry_size(const Field& field) {
+            return field.first.size() + field.second.size() + 32;
+        }
+
+        bool lookup(uint64_t index, Field& field) const {
+            if (index == 0) return false;
+            if (index <= static_entries) {
+                field = { std::string(static_table[index].first), std::string(static_table[index].second) };
+                return true;
+            }
+            index -= static_entries + 1;
+            if (index >= dynamic.size()) return false;
+            field = dynamic[(size_t)index];
+            return true;
+        }
+
+        void evict(size_t incoming) {
+            while (!dynamic.empty() && size + incoming > max_size) {
+                size -= entry_size(dynamic.back());
+                dynamic.pop_back();
+            }
+        }
+
+        void insert(const Field& field) {
+            const size_t needed = entry_size(field);
+            evict(needed);
+            if (needed > max_size) return; // clears the table and is not added
+            dynamic.push_front(field);
+            size += needed;
+        }
+    };
+
+    // Response header block: :status and content-type through static table names, anything
+    // else as a literal without indexing. Names must already be lowercase.
+    inline std::string encode_response_headers(int status, const std::vector<std::pair<std::string, std::string>>& headers) {
+        std::string block;
+        if (status == 200) {
+            encode_integer(block, 0x80, 7, 8);
+        } else {
+            encode_integer(block, 0x00, 4, 8);
+            encode_string(block, std::to_string(status));
+        }
+
+        for (const auto& [name, value] : headers) {
+            size_t index = 0;
+            for (size_t i = 15; i <= static_entries && !index; ++i) {
+                if (static_table[i].first == name) index = i;
+            }
+            encode_integer(block, 0x00, 4, index);
+            if (!index) encode_string(block, name);
+            encode_string(block, value);
+        }
+        return block;
+    }
+}
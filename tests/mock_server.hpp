@@ -0,0 +1,820 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <ctime>
+#include <csignal>
+#include "transport.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef KEYAUTH_MOCK_TLS
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include "mock_http2.hpp"
+#endif
+
+#ifdef KEYAUTH_MOCK_GZIP
+#include <zlib.h>
+#endif
+
+// A local HTTP/1.1 server on 127.0.0.1 for tests and benchmarks that need real sockets, where
+// transport::Loopback would skip what is being measured: connection reuse, timeouts, TLS and the
+// curl_multi engine. With KEYAUTH_MOCK_TLS (OpenSSL) it also serves HTTPS with a self-signed
+// certificate generated at startup; pass ca_file() as the KeyAuth ca_bundle. Over TLS it can
+// also offer HTTP/2 through ALPN (mock_http2.hpp), and with KEYAUTH_MOCK_GZIP (zlib) it can
+// gzip replies for clients that accept it, for the transport benchmarks.
+//
+// Every connection gets its own thread. The handler scripts each reply and can inject faults:
+// any status, a delay before answering, or a connection dropped without an answer. Replies on
+// one connection go out in request order, HTTP/2 streams included.
+namespace mock {
+    struct Request {
+        std::string path;
+        std::string body;        // form body as sent, see transport::param()
+        std::string accept_encoding; // Accept-Encoding header value; empty if not sent
+        unsigned long count = 0; // requests seen on this path so far, this one included
+    };
+
+    struct Reply {
+        int status = 200;
+        std::string body;
+        std::chrono::milliseconds delay{0}; // before anything is written
+        bool drop = false;                  // close the connection instead of answering
+        std::string headers;                // extra header lines, each ending in \r\n
+    };
+
+    using Handler = std::function<void(const Request&, Reply&)>;
+
+    // What a server offers besides plain HTTP/1.1. The constructor throws for anything that was
+    // not compiled in.
+    struct Options {
+        bool tls = false;   // KEYAUTH_MOCK_TLS
+        bool http2 = false; // h2 through ALPN, so TLS only; HTTP/1.1 stays available
+        bool gzip = false;  // KEYAUTH_MOCK_GZIP; only for requests with gzip in Accept-Encoding
+    };
+
+#ifdef KEYAUTH_MOCK_GZIP
+    inline std::string gzip(const std::string& data) {
+        z_stream stream = {};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("mock: deflateInit2 failed");
+        }
+
+        std::string out(deflateBound(&stream, (uLong)data.size()), '\0');
+        stream.next_in = (Bytef*)data.data();
+        stream.avail_in = (uInt)data.size();
+        stream.next_out = (Bytef*)&out[0];
+        stream.avail_out = (uInt)out.size();
+        const int result = deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (result != Z_STREAM_END) throw std::runtime_error("mock: deflate failed");
+        return out;
+    }
+#endif
+
+    // The 1.2 API as far as the client uses it: init opens session "mock", check accepts only
+    // that session, and login, license and register accept any credentials
+    inline void keyauth_api(const Request& request, Reply& reply) {
+        const std::string_view type = transport::param(request.body, "type");
+        if (type == "init") {
+            reply.body = "{\"success\":true,\"message\":\"Initialized\",\"sessionid\":\"mock\"}";
+        } else if (type == "check") {
+            reply.body = transport::param(request.body, "sessionid") == "mock"
+                ? "{\"success\":true,\"message\":\"Session is validated.\"}"
+                : "{\"success\":false,\"message\":\"Session not found.\"}";
+        } else if (type == "login" || type == "license" || type == "register") {
+            reply.body = "{\"success\":true,\"message\":\"Logged in!\",\"info\":{\"username\":\"mock\",\"ip\":\"127.0.0.1\","
+                         "\"hwid\":\"\",\"createdate\":\"1700000000\",\"lastlogin\":\"1700000100\",\"subscriptions\":"
+                         "[{\"subscription\":\"default\",\"key\":null,\"expiry\":\"4102444800\",\"timeleft\":1}]}}";
+        } else {
+            reply.body = "{\"success\":false,\"message\":\"Unhandled request type\"}";
+        }
+    }
+
+#ifdef KEYAUTH_MOCK_TLS
+    // Self-signed P-256 certificate for localhost and 127.0.0.1, valid for a day. The PEM is
+    // written to a temporary file for the client to trust; it is removed with the object.
+    class Certificate {
+    public:
+        Certificate() {
+            key = EVP_EC_gen("P-256");
+            X509* cert = X509_new();
+            if (!key || !cert) throw std::runtime_error("mock: cannot create certificate");
+
+            X509_set_version(cert, 2);
+            ASN1_INTEGER_set(X509_get_serialNumber(cert), (long)time(nullptr));
+            X509_gmtime_adj(X509_getm_notBefore(cert), -3600);
+            X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+            X509_set_pubkey(cert, key);
+
+            X509_NAME* name = X509_get_subject_name(cert);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+            X509_set_issuer_name(cert, name);
+
+            X509V3_CTX context;
+            X509V3_set_ctx_nodb(&context);
+            X509V3_set_ctx(&context, cert, cert, nullptr, nullptr, 0);
+            if (X509_EXTENSION* san = X509V3_EXT_conf_nid(nullptr, &context, NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1")) {
+                X509_add_ext(cert, san, -1);
+                X509_EXTENSION_free(san);
+            }
+            if (!X509_sign(cert, key, EVP_sha256())) throw std::runtime_error("mock: cannot sign certificate");
+            certificate = cert;
+
+            char path[] = "/tmp/keyauth_mock_ca_XXXXXX";
+            const int fd = mkstemp(path);
+            FILE* file = fd >= 0 ? fdopen(fd, "w") : nullptr;
+            if (!file) throw std::runtime_error("mock: cannot write certificate");
+            PEM_write_X509(file, cert);
+            fclose(file);
+            pem_path = path;
+        }
+
+        ~Certificate() {
+            if (!pem_path.empty()) std::remove(pem_path.c_str());
+            X509_free(certificate);
+            EVP_PKEY_free(key);
+        }
+
+        Certificate(const Certificate&) = delete;
+        Certificate& operator=(const Certificate&) = delete;
+
+        // Configures ctx to present this certificate
+        bool use(SSL_CTX* ctx) const {
+            return SSL_CTX_use_certificate(ctx, certificate) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+        }
+
+        const std::string& pem() const {
+            return pem_path;
+        }
+
+    private:
+        EVP_PKEY* key = nullptr;
+        X509* certificate = nullptr;
+        std::string pem_path;
+    };
+#endif
+
+    class Server {
+    public:
+        // tls needs KEYAUTH_MOCK_TLS; the constructor throws if it is not compiled in
+        explicit Server(Handler handler = keyauth_api, bool tls = false) : Server(std::move(handler), Options{tls}) {}
+
+        Server(Handler handler, const Options& options) : handler(std::move(handler)), options(options) {
+            if (options.http2 && !options.tls) throw std::runtime_error("mock: HTTP/2 is only offered over TLS");
+#ifndef KEYAUTH_MOCK_GZIP
+            if (options.gzip) throw std::runtime_error("mock: built without KEYAUTH_MOCK_GZIP");
+#endif
+            if (options.tls) {
+#ifdef KEYAUTH_MOCK_TLS
+                certificate = std::make_unique<Certificate>();
+                ssl_ctx = SSL_CTX_new(TLS_server_method());
+                if (!ssl_ctx || !certificate->use(ssl_ctx)) throw std::runtime_error("mock: cannot set up TLS");
+                if (options.http2) SSL_CTX_set_alpn_select_cb(ssl_ctx, select_protocol, nullptr);
+                // SSL_write() uses write(), not send(MSG_NOSIGNAL): a client that hangs up
+                // mid-reply must fail the write, not kill the process
+                signal(SIGPIPE, SIG_IGN);
+#else
+                throw std::runtime_error("mock: built without KEYAUTH_MOCK_TLS");
+#endif
+            }
+
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            int yes = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t size = sizeof(address);
+            if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listen_fd, 128) != 0 ||
+                getsockname(listen_fd, (sockaddr*)&address, &size) != 0) {
+                throw std::runtime_error("mock: cannot listen on 127.0.0.1");
+            }
+            bound_port = ntohs(address.sin_port);
+
+            acceptor = std::thread([this] { accept_loop(); });
+        }
+
+        ~Server() {
+            stop();
+#ifdef KEYAUTH_MOCK_TLS
+            if (ssl_ctx) SSL_CTX_free(ssl_ctx);
+#endif
+        }
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        // Base URL plus path, e.g. url("flaky/") for requests that land on /flaky/
+        std::string url(const std::string& path = "") const {
+            return std::string(options.tls ? "https" : "http") + "://127.0.0.1:" + std::to_string(bound_port) + "/" + path;
+        }
+
+        // PEM of the self-signed certificate for the KeyAuth ca_bundle; empty without TLS
+        std::string ca_file() const {
+#ifdef KEYAUTH_MOCK_TLS
+            if (certificate) return certificate->pem();
+#endif
+            return "";
+        }
+
+        unsigned long requests(const std::string& path) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = counts.find(path);
+            return it == counts.end() ? 0 : it->second;
+        }
+
+        unsigned long connections() const {
+            return accepted.load();
+        }
+
+        // TLS handshakes that resumed an earlier session instead of sending the certificate
+        unsigned long resumed() const {
+            return resumed_handshakes.load();
+        }
+
+        // Bytes read from and written to client sockets, TLS records and HTTP/2 framing included
+        unsigned long long bytes_received() const {
+            return received.load();
+        }
+
+        unsigned long long bytes_sent() const {
+            return sent.load();
+        }
+
+        // Closes the listener and every open connection; delayed replies are abandoned
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) return;
+                stopping = true;
+                for (int fd : open_fds) shutdown(fd, SHUT_RDWR);
+            }
+            wake.notify_all();
+            shutdown(listen_fd, SHUT_RDWR);
+            acceptor.join();
+            close(listen_fd);
+
+            std::vector<std::thread> finished;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.swap(workers);
+            }
+            for (auto& worker : finished) worker.join();
+        }
+
+    private:
+        Handler handler;
+        Options options;
+        int listen_fd = -1;
+        int bound_port = 0;
+        std::thread acceptor;
+        std::atomic<unsigned long> accepted{0};
+        std::atomic<unsigned long> resumed_handshakes{0};
+        std::atomic<unsigned long long> received{0};
+        std::atomic<unsigned long long> sent{0};
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+        std::vector<std::thread> workers;
+        std::vector<int> open_fds;
+        std::unordered_map<std::string, unsigned long> counts;
+
+#ifdef KEYAUTH_MOCK_TLS
+        std::unique_ptr<Certificate> certificate;
+        SSL_CTX* ssl_ctx = nullptr;
+#endif
+
+        // A client socket, with TLS on top when the server has it. Plain sockets count their
+        // bytes here, TLS ones in count_bio() below the TLS layer.
+        struct Connection {
+            Server& server;
+            int fd = -1;
+#ifdef KEYAUTH_MOCK_TLS
+            SSL* ssl = nullptr;
+#endif
+
+            long read(char* buffer, size_t size) {
+#ifdef KEYAUTH_MOCK_TLS
+                if (ssl) return SSL_read(ssl, buffer, (int)size);
+#endif
+                const long count = (long)recv(fd, buffer, size, 0);
+                if (count > 0) server.received += (unsigned long long)count;
+                return count;
+            }
+
+            bool write(const std::string& data) {
+                for (size_t offset = 0; offset < data.size();) {
+                    long count;
+#ifdef KEYAUTH_MOCK_TLS
+                    if (ssl) count = SSL_write(ssl, data.data() + offset, (int)(data.size() - offset));
+                    else
+#endif
+                    {
+                        count = (long)send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+                        if (count > 0) server.sent += (unsigned long long)count;
+                    }
+                    if (count <= 0) return false;
+                    offset += (size_t)count;
+                }
+                return true;
+            }
+        };
+
+        void accept_loop() {
+            for (;;) {
+                const int fd = accept(listen_fd, nullptr, nullptr);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping) {
+                    if (fd >= 0) close(fd);
+                    return;
+                }
+                if (fd < 0) continue;
+
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                accepted++;
+                open_fds.push_back(fd);
+                workers.emplace_back([this, fd] { serve(fd); });
+            }
+        }
+
+#ifdef KEYAUTH_MOCK_TLS
+        // ALPN: h2 if the client offers it, otherwise HTTP/1.1
+        static int select_protocol(SSL*, const unsigned char** out, unsigned char* out_size, const unsigned char* in,
+                                   unsigned int in_size, void*) {
+            static const unsigned char supported[] = "\x02h2\x08http/1.1";
+            if (SSL_select_next_proto((unsigned char**)out, out_size, supported, sizeof(supported) - 1, in, in_size) != OPENSSL_NPN_NEGOTIATED) {
+                return SSL_TLSEXT_ERR_NOACK;
+            }
+            return SSL_TLSEXT_ERR_OK;
+        }
+
+        static long count_bio(BIO* bio, int operation, const char*, size_t, int, long, int result, size_t* processed) {
+            Server* server = (Server*)BIO_get_callback_arg(bio);
+            if (result > 0 && processed) {
+                if (operation == (BIO_CB_READ | BIO_CB_RETURN)) server->received += *processed;
+                else if (operation == (BIO_CB_WRITE | BIO_CB_RETURN)) server->sent += *processed;
+            }
+            return result;
+        }
+#endif
+
+        void serve(int fd) {
+            Connection connection{*this, fd};
+#ifdef KEYAUTH_MOCK_TLS
+            bool http2 = false;
+            if (ssl_ctx) {
+                connection.ssl = SSL_new(ssl_ctx);
+                SSL_set_fd(connection.ssl, fd);
+                BIO* bio = SSL_get_rbio(connection.ssl);
+                BIO_set_callback_ex(bio, count_bio);
+                BIO_set_callback_arg(bio, (char*)this);
+                if (SSL_accept(connection.ssl) != 1) {
+                    SSL_free(connection.ssl);
+                    connection.ssl = nullptr;
+                    finish(fd);
+                    return;
+                }
+                if (SSL_session_reused(connection.ssl)) resumed_handshakes++;
+
+                const unsigned char* protocol = nullptr;
+                unsigned int size = 0;
+                SSL_get0_alpn_selected(connection.ssl, &protocol, &size);
+                http2 = size == 2 && memcmp(protocol, "h2", 2) == 0;
+            }
+
+            if (http2) exchange_http2(connection);
+            else
+#endif
+                exchange(connection);
+
+#ifdef KEYAUTH_MOCK_TLS
+            if (connection.ssl) {
+                SSL_shutdown(connection.ssl);
+                SSL_free(connection.ssl);
+            }
+#endif
+            finish(fd);
+        }
+
+        void finish(int fd) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                open_fds.erase(std::remove(open_fds.begin(), open_fds.end(), fd), open_fds.end());
+            }
+            close(fd);
+        }
+
+        static bool header_is(std::string_view line, std::string_view name) {
+            if (line.size() <= name.size() || line[name.size()] != ':') return false;
+            for (size_t i = 0; i < name.size(); ++i) {
+                if (tolower((unsigned char)line[i]) != name[i]) return false;
+            }
+            return true;
+        }
+
+        static const char* reason(int status) {
+            switch (status) {
+                case 200: return "OK";
+                case 400: return "Bad Request";
+                case 418: return "I'm a teapot";
+                case 429: return "Too Many Requests";
+                case 500: return "Internal Server Error";
+                case 502: return "Bad Gateway";
+                case 503: return "Service Unavailable";
+                default: return "Status";
+            }
+        }
+
+        // Runs the handler, waits out the reply's delay and gzips the body if the client accepts
+        // it. False if the server is stopping or the reply drops the connection.
+        bool answer(Request& request, Reply& reply) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                request.count = ++counts[request.path];
+            }
+
+            handler(request, reply);
+
+            if (reply.delay.count() > 0) {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (wake.wait_for(lock, reply.delay, [this] { return stopping; })) return false;
+            }
+            if (reply.drop) return false;
+
+#ifdef KEYAUTH_MOCK_GZIP
+            if (options.gzip && request.accept_encoding.find("gzip") != std::string::npos) {
+                reply.body = gzip(reply.body);
+                reply.headers += "Content-Encoding: gzip\r\n";
+            }
+#endif
+            return true;
+        }
+
+        // Keep-alive request loop: one reply per request, in order, until either side closes
+        void exchange(Connection& connection) {
+            std::string buffer;
+            char chunk[16384];
+            auto fill = [&] {
+                const long count = connection.read(chunk, sizeof(chunk));
+                if (count <= 0) return false;
+                buffer.append(chunk, (size_t)count);
+                return true;
+            };
+
+            for (;;) {
+                size_t header_end;
+                while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+                    if (!fill()) return;
+                }
+
+                const std::string_view head(buffer.data(), header_end);
+                const size_t path_start = head.find(' ') + 1;
+                Request request;
+                request.path = std::string(head.substr(path_start, head.find(' ', path_start) - path_start));
+
+                size_t content_length = 0;
+                bool keep_alive = true;
+                for (size_t line_start = head.find("\r\n"); line_start != std::string_view::npos;) {
+                    line_start += 2;
+                    const size_t line_end = head.find("\r\n", line_start);
+                    const std::string_view line = head.substr(line_start, line_end - line_start);
+                    if (header_is(line, "content-length")) content_length = strtoul(std::string(line.substr(15)).c_str(), nullptr, 10);
+                    else if (header_is(line, "connection") && line.find("close") != std::string_view::npos) keep_alive = false;
+                    else if (header_is(line, "accept-encoding")) request.accept_encoding = std::string(line.substr(std::min(line.find_first_not_of(' ', 16), line.size())));
+                    else if (header_is(line, "expect") && !connection.write("HTTP/1.1 100 Continue\r\n\r\n")) return;
+                    line_start = line_end;
+                }
+
+                const size_t body_start = header_end + 4;
+                while (buffer.size() < body_start + content_length) {
+                    if (!fill()) return;
+                }
+                request.body = buffer.substr(body_start, content_length);
+                buffer.erase(0, body_start + content_length);
+
+                Reply reply;
+                if (!answer(request, reply)) return;
+
+                std::string response = "HTTP/1.1 " + std::to_string(reply.status) + " " + reason(reply.status) +
+                                       "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(reply.body.size()) + "\r\n" +
+                                       reply.headers + (keep_alive ? "\r\n" : "Connection: close\r\n\r\n");
+                response += reply.body;
+                if (!connection.write(response) || !keep_alive) return;
+            }
+        }
+
+#ifdef KEYAUTH_MOCK_TLS
+        // HTTP/2 once ALPN picked h2: each stream is one request, answered when its END_STREAM
+        // arrives. The client's flow-control windows are honoured; ours are kept wide open.
+        void exchange_http2(Connection& connection) {
+            using namespace http2;
+
+            std::string buffer;
+            char chunk[16384];
+            auto fill = [&] {
+                const long count = connection.read(chunk, sizeof(chunk));
+                if (count <= 0) return false;
+                buffer.append(chunk, (size_t)count);
+                return true;
+            };
+
+            auto read_frame = [&](Frame& frame) {
+                while (buffer.size() < 9) {
+                    if (!fill()) return false;
+                }
+                const size_t length = (size_t)(uint8_t)buffer[0] << 16 | (size_t)(uint8_t)buffer[1] << 8 | (uint8_t)buffer[2];
+                while (buffer.size() < 9 + length) {
+                    if (!fill()) return false;
+                }
+                frame.type = (uint8_t)buffer[3];
+                frame.flags = (uint8_t)buffer[4];
+                frame.stream = read32(&buffer[5]) & 0x7FFFFFFF;
+                frame.payload.assign(buffer, 9, length);
+                buffer.erase(0, 9 + length);
+                return true;
+            };
+
+            while (buffer.size() < preface.size()) {
+                if (!fill()) return;
+            }
+            if (buffer.compare(0, preface.size(), preface) != 0) return;
+            buffer.erase(0, preface.size());
+
+            std::string out;
+            append_frame(out, SETTINGS, 0, 0, "");
+            append_frame(out, WINDOW_UPDATE, 0, 0, u32(1 << 30));
+            if (!connection.write(out)) return;
+
+            struct Stream {
+                Request request;
+                int64_t window = 0; // what we may still send on it
+            };
+            std::unordered_map<uint32_t, Stream> streams;
+            std::deque<uint32_t> ready; // streams with a complete request, in arrival order
+            HeaderDecoder decoder;
+            int64_t connection_window = default_window;
+            uint32_t initial_window = default_window;
+            uint32_t frame_size = default_frame_size;
+            std::string header_block;
+            uint32_t header_stream = 0;
+            uint8_t header_flags = 0;
+
+            // Payload without padding (and without the priority block of HEADERS)
+            auto content = [](const Frame& frame, std::string_view& out) {
+                std::string_view payload = frame.payload;
+                if (frame.flags & PADDED) {
+                    if (payload.empty() || (uint8_t)payload[0] >= payload.size()) return false;
+                    payload = payload.substr(1, payload.size() - 1 - (uint8_t)payload[0]);
+                }
+                if (frame.type == HEADERS && (frame.flags & PRIORITY_FLAG)) {
+                    if (payload.size() < 5) return false;
+                    payload.remove_prefix(5);
+                }
+                out = payload;
+                return true;
+            };
+
+            // False ends the connection
+            auto process = [&](const Frame& frame) {
+                std::string reply;
+                std::string_view data;
+                switch (frame.type) {
+                    case SETTINGS:
+                        if (frame.flags & ACK) return true;
+                        for (size_t i = 0; i + 6 <= frame.payload.size(); i += 6) {
+                            const uint16_t id = (uint16_t)((uint8_t)frame.payload[i] << 8 | (uint8_t)frame.payload[i + 1]);
+                            const uint32_t value = read32(&frame.payload[i + 2]);
+                            if (id == INITIAL_WINDOW_SIZE) {
+                                for (auto& entry : streams) entry.second.window += (int64_t)value - initial_window;
+                                initial_window = value;
+                            } else if (id == MAX_FRAME_SIZE) {
+                                frame_size = value;
+                            }
+                        }
+                        append_frame(reply, SETTINGS, ACK, 0, "");
+                        return connection.write(reply);
+
+                    case WINDOW_UPDATE: {
+                        if (frame.payload.size() != 4) return false;
+                        const uint32_t increment = read32(frame.payload.data()) & 0x7FFFFFFF;
+                        if (frame.stream == 0) connection_window += increment;
+                        else if (auto it = streams.find(frame.stream); it != streams.end()) it->second.window += increment;
+                        return true;
+                    }
+
+                    case PING:
+                        if (frame.flags & ACK) return true;
+                        append_frame(reply, PING, ACK, 0, frame.payload);
+                        return connection.write(reply);
+
+                    case HEADERS:
+                    case CONTINUATION: {
+                        if (frame.type == HEADERS) {
+                            header_block.clear();
+                            header_stream = frame.stream;
+                            header_flags = frame.flags;
+                        } else if (frame.stream != header_stream) {
+                            return false;
+                        }
+                        if (!content(frame, data)) return false;
+                        header_block += data;
+                        if (!(frame.flags & END_HEADERS)) return true;
+
+                        std::vector<HeaderDecoder::Field> fields;
+                        if (!decoder.decode(header_block, fields)) return false;
+
+                        Stream& stream = streams[header_stream];
+                        stream.window = initial_window;
+                        for (const auto& [name, value] : fields) {
+                            if (name == ":path") stream.request.path = value;
+                            else if (name == "accept-encoding") stream.request.accept_encoding = value;
+                        }
+                        if (header_flags & END_STREAM) ready.push_back(header_stream);
+                        return true;
+                    }
+
+                    case DATA: {
+                        if (!content(frame, data)) return false;
+                        auto it = streams.find(frame.stream);
+                        if (it != streams.end()) it->second.request.body += data;
+
+                        // Hand the window straight back so the client never waits on us
+                        if (!frame.payload.empty()) {
+                            append_frame(reply, WINDOW_UPDATE, 0, 0, u32((uint32_t)frame.payload.size()));
+                            if (!(frame.flags & END_STREAM)) append_frame(reply, WINDOW_UPDATE, 0, frame.stream, u32((uint32_t)frame.payload.size()));
+                            if (!connection.write(reply)) return false;
+                        }
+                        if ((frame.flags & END_STREAM) && it != streams.end()) ready.push_back(frame.stream);
+                        return true;
+                    }
+
+                    case RST_STREAM:
+                        streams.erase(frame.stream);
+                        return true;
+
+                    case GOAWAY:
+                        return false;
+
+                    default: // PRIORITY and unknown types
+                        return true;
+                }
+            };
+
+            // HEADERS, then DATA in chunks the client's windows and frame size allow, reading
+            // its frames meanwhile whenever a window is shut
+            auto respond = [&](uint32_t id, const Reply& reply) {
+                std::vector<std::pair<std::string, std::string>> headers = {
+                    {"content-type", "application/json"}, {"content-length", std::to_string(reply.body.size())}};
+                for (size_t start = 0; start < reply.headers.size();) {
+                    const size_t end = reply.headers.find("\r\n", start);
+                    const std::string line = reply.headers.substr(start, end - start);
+                    const size_t colon = line.find(':');
+                    if (colon != std::string::npos) {
+                        std::string name = line.substr(0, colon);
+                        for (char& c : name) c = (char)tolower((unsigned char)c);
+                        headers.emplace_back(name, line.substr(std::min(line.find_first_not_of(' ', colon + 1), line.size())));
+                    }
+                    if (end == std::string::npos) break;
+                    start = end + 2;
+                }
+
+                // Frames are written together, in as few TLS records as the windows allow
+                std::string frames;
+                append_frame(frames, HEADERS, (uint8_t)(END_HEADERS | (reply.body.empty() ? END_STREAM : 0)), id,
+                             encode_response_headers(reply.status, headers));
+
+                Frame frame;
+                for (size_t offset = 0; offset < reply.body.size();) {
+                    auto it = streams.find(id);
+                    if (it == streams.end()) return true; // reset by the client
+
+                    const int64_t allowed = std::min<int64_t>({connection_window, it->second.window, (int64_t)frame_size});
+                    if (allowed <= 0) {
+                        if (!connection.write(frames)) return false;
+                        frames.clear();
+                        if (!read_frame(frame) || !process(frame)) return false;
+                        continue;
+                    }
+
+                    const size_t size = std::min(reply.body.size() - offset, (size_t)allowed);
+                    append_frame(frames, DATA, offset + size == reply.body.size() ? END_STREAM : 0, id,
+                                 std::string_view(reply.body).substr(offset, size));
+                    connection_window -= (int64_t)size;
+                    it->second.window -= (int64_t)size;
+                    offset += size;
+                }
+                return frames.empty() || connection.write(frames);
+            };
+
+            Frame frame;
+            for (;;) {
+                while (!ready.empty()) {
+                    const uint32_t id = ready.front();
+                    ready.pop_front();
+                    auto it = streams.find(id);
+                    if (it == streams.end()) continue;
+
+                    Request request = std::move(it->second.request);
+                    Reply reply;
+                    if (!answer(request, reply) || !respond(id, reply)) return;
+                    streams.erase(id);
+                }
+                if (!read_frame(frame) || !process(frame)) return;
+            }
+        }
+#endif
+    };
+
+    // A Server in a forked child, for benchmarks: its threads, CPU time and allocations stay out
+    // of the measuring process. Construct it before starting any threads; the child exits when
+    // the object is destroyed (or the parent dies).
+    class Process {
+    public:
+        explicit Process(Handler handler = keyauth_api, bool tls = false) : Process(std::move(handler), Options{tls}) {}
+
+        Process(Handler handler, const Options& options) {
+            int address[2], alive[2];
+            if (pipe(address) != 0 || pipe(alive) != 0) throw std::runtime_error("mock: pipe failed");
+
+            pid = fork();
+            if (pid < 0) throw std::runtime_error("mock: fork failed");
+            if (pid == 0) {
+                close(address[0]);
+                close(alive[1]);
+                Server server(std::move(handler), options);
+                const std::string line = server.url() + "\n" + server.ca_file() + "\n";
+                if (::write(address[1], line.data(), line.size()) != (ssize_t)line.size()) _exit(1);
+                char byte;
+                while (::read(alive[0], &byte, 1) > 0) {}
+                server.stop();
+                _exit(0);
+            }
+
+            close(address[1]);
+            close(alive[0]);
+            keep_alive = alive[1];
+
+            std::string text;
+            char buffer[512];
+            for (ssize_t n; std::count(text.begin(), text.end(), '\n') < 2 && (n = ::read(address[0], buffer, sizeof(buffer))) > 0;) {
+                text.append(buffer, (size_t)n);
+            }
+            close(address[0]);
+
+            const size_t split = text.find('\n');
+            const size_t end = split == std::string::npos ? split : text.find('\n', split + 1);
+            if (end == std::string::npos) throw std::runtime_error("mock: server process did not start");
+            base_url = text.substr(0, split);
+            ca_pem = text.substr(split + 1, end - split - 1);
+        }
+
+        ~Process() {
+            close(keep_alive);
+            waitpid(pid, nullptr, 0);
+        }
+
+        Process(const Process&) = delete;
+        Process& operator=(const Process&) = delete;
+
+        std::string url(const std::string& path = "") const {
+            return base_url + path;
+        }
+
+        const std::string& ca_file() const {
+            return ca_pem;
+        }
+
+    private:
+        pid_t pid = -1;
+        int keep_alive = -1;
+        std::string base_url;
+        std::string ca_pem;
+    };
+}
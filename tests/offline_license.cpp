@@ -0,0 +1,155 @@
+// Offline license tokens end to end: a loopback signs login responses the way the server does
+// (license_token::sign), the client keeps the signed body, and a second client verifies it with
+// restore_offline() without a request. Built with KEYAUTH_OFFLINE_LICENSE and
+// KEYAUTH_LICENSE_SIGNER, so it only exists where OpenSSL was found.
+#include "keyauth.hpp"
+#include "check.hpp"
+
+namespace {
+    constexpr auto grace = std::chrono::hours(24);
+    constexpr time_t far_future = 4102444800; // 2100-01-01
+
+    // What the signing loopback puts in the login it signs
+    struct Signer {
+        license_token::KeyPair keys;
+        long long signed_at = (long long)time(nullptr);
+        time_t expiry = far_future;
+        std::string hwid; // empty = the one the client sent
+    };
+
+    std::shared_ptr<transport::Loopback> signing_loopback(const Signer& signer) {
+        auto server = transport::keyauth_loopback("signed");
+        server->on("login", [signer](const transport::Request& request, transport::Response& response) {
+            std::string body = "{\"success\":true,\"message\":\"Logged in!\",\"info\":{\"username\":\"";
+            transport::append_json_value(body, transport::param(request.body, "username"));
+            body += "\",\"ip\":\"127.0.0.1\",\"hwid\":\"";
+            if (signer.hwid.empty()) transport::append_json_value(body, transport::param(request.body, "hwid"));
+            else body += signer.hwid;
+            body += "\",\"createdate\":\"1700000000\",\"lastlogin\":\"1700000100\",\"subscriptions\":[{\"subscription\":\"default\","
+                    "\"key\":null,\"expiry\":\"" + std::to_string((long long)signer.expiry) + "\",\"timeleft\":1}]}}";
+
+            const license_token::Token token = license_token::sign(signer.keys.private_key, body, signer.signed_at);
+            response.response_code = 200;
+            response.data = token.body;
+            response.signature = token.signature;
+            response.signature_timestamp = token.timestamp;
+        });
+        return server;
+    }
+
+    KeyAuth::Session signed_session(const Signer& signer) {
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", signing_loopback(signer));
+        CHECK(client.init());
+        CHECK(client.login("someone", "pass").success);
+
+        const KeyAuth::Session session = client.get_session();
+        CHECK(!session.token.empty());
+        return session;
+    }
+
+    // A fresh client, as on the next launch; nothing it does may reach the server
+    KeyAuth::OfflineStatus restore(const KeyAuth::Session& cached, const std::string& public_key) {
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        const auto status = client.restore_offline(cached, public_key, grace);
+
+        CHECK(server->requests("init") == 0 && server->requests("check") == 0);
+        CHECK(client.is_logged_in() == (status == KeyAuth::OfflineStatus::valid));
+        return status;
+    }
+
+    void valid_token_restores_the_signed_user() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        CHECK(!signer.keys.public_key.empty());
+
+        KeyAuth::Session cached = signed_session(signer);
+        CHECK(license_token::verify(cached.token, signer.keys.public_key));
+
+        // The user info comes from the signed body, not from whatever the cache file says
+        cached.user.username = "edited";
+        cached.user.subscriptions.clear();
+
+        auto server = transport::keyauth_loopback();
+        KeyAuth client("app", "secret", "1.0", "https://keyauth.invalid/api/1.2/", "", "", "", server);
+        CHECK(client.restore_offline(cached, signer.keys.public_key, grace) == KeyAuth::OfflineStatus::valid);
+        CHECK(client.is_logged_in());
+        CHECK(client.get_username() == "someone");
+        CHECK(client.get_session_id() == "signed");
+        CHECK(client.session()->expiry == far_future);
+        CHECK(server->requests("init") == 0 && server->requests("check") == 0);
+    }
+
+    void stale_token_needs_an_online_check() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        signer.signed_at = (long long)time(nullptr) - std::chrono::duration_cast<std::chrono::seconds>(grace).count() - 60;
+        CHECK(restore(signed_session(signer), signer.keys.public_key) == KeyAuth::OfflineStatus::stale);
+
+        // Just inside the window is still fine
+        signer.signed_at += 120;
+        CHECK(restore(signed_session(signer), signer.keys.public_key) == KeyAuth::OfflineStatus::valid);
+    }
+
+    void tampered_payload_is_invalid() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        const KeyAuth::Session genuine = signed_session(signer);
+
+        KeyAuth::Session cached = genuine;
+        const size_t expiry = cached.token.body.find("4102444800");
+        CHECK(expiry != std::string::npos);
+        cached.token.body[expiry] = '5'; // a later expiry
+        CHECK(restore(cached, signer.keys.public_key) == KeyAuth::OfflineStatus::invalid);
+
+        cached = genuine;
+        cached.token.timestamp = std::to_string(strtoll(cached.token.timestamp.c_str(), nullptr, 10) + 1);
+        CHECK(restore(cached, signer.keys.public_key) == KeyAuth::OfflineStatus::invalid);
+
+        cached = genuine;
+        cached.token.signature[0] = cached.token.signature[0] == '0' ? '1' : '0';
+        CHECK(restore(cached, signer.keys.public_key) == KeyAuth::OfflineStatus::invalid);
+
+        cached = genuine;
+        cached.token = {};
+        CHECK(restore(cached, signer.keys.public_key) == KeyAuth::OfflineStatus::invalid);
+    }
+
+    void expired_subscription_is_expired() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        signer.expiry = time(nullptr) - 60;
+        CHECK(restore(signed_session(signer), signer.keys.public_key) == KeyAuth::OfflineStatus::expired);
+    }
+
+    void other_machine_is_invalid() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        signer.hwid = "S-1-5-21-0000000000-0000000000-0000000000-1000";
+        CHECK(restore(signed_session(signer), signer.keys.public_key) == KeyAuth::OfflineStatus::invalid);
+    }
+
+    void wrong_public_key_is_invalid() {
+        Signer signer;
+        signer.keys = license_token::generate_keypair();
+        const KeyAuth::Session cached = signed_session(signer);
+
+        CHECK(restore(cached, license_token::generate_keypair().public_key) == KeyAuth::OfflineStatus::invalid);
+        CHECK(restore(cached, "") == KeyAuth::OfflineStatus::invalid);
+        CHECK(restore(cached, signer.keys.public_key.substr(2)) == KeyAuth::OfflineStatus::invalid);
+    }
+}
+
+int main() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    check::run("a valid token restores the signed user", valid_token_restores_the_signed_user);
+    check::run("a stale token needs an online check", stale_token_needs_an_online_check);
+    check::run("a tampered payload is invalid", tampered_payload_is_invalid);
+    check::run("an expired subscription is expired", expired_subscription_is_expired);
+    check::run("another machine's token is invalid", other_machine_is_invalid);
+    check::run("the wrong public key is invalid", wrong_public_key_is_invalid);
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,99 @@
+// c_render_scheduler (render_scheduler.hpp), the policy that lets the UI skip frames: it sleeps
+// while nothing changed, wakes on input from another thread, and honours the deadline the caret
+// blink schedules. Time points are passed in where the API allows, so only the wait() cases
+// depend on the real clock.
+#include "render_scheduler.hpp"
+#include "check.hpp"
+
+#include <thread>
+
+using namespace std::chrono;
+using clock_type = c_render_scheduler::clock;
+
+namespace {
+    // Renders the frames every scheduler starts with, so it is idle afterwards
+    void settle(c_render_scheduler& scheduler, clock_type::time_point now) {
+        for (int i = 0; i < c_render_scheduler::settle_frames; ++i) CHECK(scheduler.begin_frame(now));
+    }
+
+    void idle_ui_sleeps() {
+        c_render_scheduler scheduler;
+        const auto now = clock_type::now();
+        settle(scheduler, now);
+
+        CHECK(!scheduler.begin_frame(now));
+        CHECK(!scheduler.begin_frame(now + hours(1)));
+        CHECK(scheduler.time_until_next(now) == clock_type::duration::max());
+        CHECK(scheduler.frames_rendered() == (unsigned long long)c_render_scheduler::settle_frames);
+        CHECK(scheduler.frames_skipped() == 2);
+    }
+
+    void input_wakes_the_ui() {
+        c_render_scheduler scheduler;
+        const auto now = clock_type::now();
+        settle(scheduler, now);
+
+        // Input arrives on another thread while the render thread waits with no deadline
+        std::atomic<int> woken{0};
+        scheduler.set_waker([&] { woken++; });
+        std::thread input([&] {
+            std::this_thread::sleep_for(milliseconds(20));
+            scheduler.invalidate();
+        });
+        // With no deadline, wait() can only return once the UI is dirty
+        scheduler.wait();
+        input.join();
+
+        CHECK(woken == 1);
+        CHECK(scheduler.time_until_next(now) == clock_type::duration::zero());
+
+        // The event gets its settle frames, then the UI is idle again
+        settle(scheduler, now);
+        CHECK(!scheduler.begin_frame(now));
+
+        // A single frame for a change that needs no settling
+        scheduler.invalidate(1);
+        CHECK(scheduler.begin_frame(now));
+        CHECK(!scheduler.begin_frame(now));
+    }
+
+    void caret_blink_deadline_is_honoured() {
+        c_render_scheduler scheduler;
+        const auto start = clock_type::now();
+        settle(scheduler, start);
+
+        // As c_main::render does while a text field has focus
+        const auto blink = milliseconds(400);
+        scheduler.schedule(start + blink);
+
+        CHECK(!scheduler.begin_frame(start + milliseconds(100)));
+        CHECK(scheduler.time_until_next(start + milliseconds(100)) == milliseconds(300));
+        CHECK(!scheduler.begin_frame(start + blink - milliseconds(1)));
+        CHECK(scheduler.begin_frame(start + blink));
+
+        // A deadline lives for one frame; without a new one (focus lost) the UI goes idle
+        CHECK(!scheduler.begin_frame(start + blink + milliseconds(1)));
+        CHECK(scheduler.time_until_next(start + blink) == clock_type::duration::max());
+
+        // The earliest of several deadlines wins
+        scheduler.schedule(start + seconds(2));
+        scheduler.schedule(start + seconds(1));
+        CHECK(scheduler.time_until_next(start) == seconds(1));
+        CHECK(scheduler.begin_frame(start + seconds(1)));
+
+        // wait() returns by itself once the deadline passes
+        scheduler.schedule_in(milliseconds(30));
+        const auto waited_from = steady_clock::now();
+        scheduler.wait();
+        const auto waited = steady_clock::now() - waited_from;
+        CHECK(waited >= milliseconds(25) && waited < seconds(5));
+        CHECK(scheduler.begin_frame());
+    }
+}
+
+int main() {
+    check::run("an idle UI sleeps", idle_ui_sleeps);
+    check::run("input wakes the UI", input_wakes_the_ui);
+    check::run("the caret blink deadline is honoured", caret_blink_deadline_is_honoured);
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Form bodies from request.hpp: percent-encoding, schema order, and no heap allocations once the
+// buffer has grown to fit.
+#include "request.hpp"
+#include "alloc_count.hpp"
+#include "check.hpp"
+
+namespace {
+    void values_are_percent_encoded() {
+        std::string out;
+        request::encode<request::Login>(out, "user name", "p&ss=w+rd%", "HW-ID_1.2~", "s\xc3\xa9");
+        CHECK(out == "type=login&username=user%20name&pass=p%26ss%3Dw%2Brd%25&hwid=HW-ID_1.2~&sessionid=s%C3%A9");
+
+        request::encode<request::Check>(out, "abc", "app", "owner");
+        CHECK(out == "type=check&sessionid=abc&name=app&ownerid=owner");
+
+        request::encode<request::Register>(out, "", "", "", "", "");
+        CHECK(out == "type=register&username=&pass=&key=&hwid=&sessionid=");
+    }
+
+    void steady_state_builds_do_not_allocate() {
+        const std::string user = "someone@example.com";
+        const std::string pass = "correct horse & battery = staple";
+        const std::string hwid = "S-1-5-21-1004336348-1177238915-682003330-512";
+        const std::string session = "0123456789abcdef0123456789abcdef";
+        const std::string license = "KEYAUTH-ABCD-EFGH-IJKL";
+
+        // The first build on this thread creates the scratch buffer
+        std::string& out = request::scratch();
+        request::encode<request::Init>(out, "app", "owner", "1.0");
+
+        const unsigned long long before = alloc_count::this_thread();
+        for (int i = 0; i < 10000; ++i) {
+            request::encode<request::Init>(out, "app", "owner", "1.0");
+            request::encode<request::Login>(out, user, pass, hwid, session);
+            request::encode<request::Register>(out, user, pass, license, hwid, session);
+            request::encode<request::License>(out, license, hwid, session);
+            request::encode<request::Check>(out, session, "app", "owner");
+        }
+        CHECK(alloc_count::this_thread() == before);
+        CHECK(&request::scratch() == &out);
+    }
+
+    void oversized_bodies_grow_the_buffer_once() {
+        std::string& out = request::scratch();
+        const std::string long_pass(request::initial_reserve * 2, '&');
+
+        // Growing is counted, so the zero checks above are not vacuous
+        const unsigned long long before_growth = alloc_count::this_thread();
+        request::encode<request::Login>(out, "user", long_pass, "hwid", "session");
+        CHECK(out.size() > request::initial_reserve * 6);
+        CHECK(alloc_count::this_thread() > before_growth);
+
+        const unsigned long long before = alloc_count::this_thread();
+        for (int i = 0; i < 1000; ++i) request::encode<request::Login>(out, "user", long_pass, "hwid", "session");
+        request::encode<request::Check>(out, "session", "app", "owner");
+        CHECK(alloc_count::this_thread() == before);
+    }
+}
+
+int main() {
+    check::run("values are percent-encoded", values_are_percent_encoded);
+    check::run("steady-state builds do not allocate", steady_state_builds_do_not_allocate);
+    check::run("oversized bodies grow the buffer once", oversized_bodies_grow_the_buffer_once);
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Readers take and hold session snapshots while writers publish new ones from every direction:
+// restore_session, logout, login and the heartbeat on the network thread. Built a second time
+// with -fsanitize=thread (session_stress_tsan) where the compiler supports it. The publisher
+// underneath (published.hpp) is also run on its own, with more readers than hazard slots.
+#include "keyauth.hpp"
+#include "check.hpp"
+#include "mock_server.hpp"
+
+using namespace std::chrono;
+
+namespace {
+    constexpr int readers = 4;
+    constexpr auto duration = milliseconds(1500);
+
+    // restore_session() below always pairs user "user-N" with session "sid-N"
+    bool consistent(const KeyAuth::SessionSnapshot& snapshot) {
+        const std::string& name = snapshot.user.username;
+        if (name.rfind("user-", 0) != 0) return true;
+        return snapshot.session_id == "sid-" + name.substr(5);
+    }
+
+    void snapshots_stay_consistent_under_writers() {
+        mock::Server server;
+        KeyAuth client("app", "secret", "1.0", server.url());
+        KeyAuth::CallPolicy policy;
+        policy.rate_per_second = 0.0;
+        policy.breaker_threshold = 1000;
+        client.set_call_policy(policy);
+        CHECK(client.init());
+
+        // The mock only accepts session "mock", so each beat after a restore invalidates it
+        client.start_heartbeat(milliseconds(5), true);
+
+        std::atomic<bool> running{true};
+        std::atomic<long> reads{0}, inconsistent{0}, backwards{0};
+
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&] {
+                // Snapshots held across many publishes must stay intact until let go
+                std::vector<std::shared_ptr<const KeyAuth::SessionSnapshot>> held;
+                unsigned long long last = 0;
+                while (running) {
+                    const auto snapshot = client.session();
+                    if (snapshot->version < last) backwards++;
+                    last = snapshot->version;
+                    if (!consistent(*snapshot)) inconsistent++;
+
+                    held.push_back(snapshot);
+                    if (held.size() == 64) {
+                        for (const auto& old : held) if (!consistent(*old)) inconsistent++;
+                        held.clear();
+                    }
+
+                    (void)client.get_session();
+                    (void)client.get_username();
+                    (void)client.is_logged_in();
+                    reads++;
+                }
+            });
+        }
+
+        std::atomic<int> writes{0};
+        for (int w = 0; w < 2; ++w) {
+            threads.emplace_back([&, w] {
+                for (int i = 0; running; ++i) {
+                    const std::string id = std::to_string(w * 1000000 + i);
+                    switch (i % 4) {
+                        case 0: {
+                            KeyAuth::Session session;
+                            session.session_id = "sid-" + id;
+                            session.user.username = "user-" + id;
+                            session.user.subscriptions = {{"default", "", time(nullptr) + 3600, 0}};
+                            client.restore_session(session);
+                            break;
+                        }
+                        case 1:
+                            // logout() stops the heartbeat; keep it writing from the network thread
+                            client.logout();
+                            client.start_heartbeat(milliseconds(5), true);
+                            break;
+                        case 2: (void)client.login_async("user", "pass").get(); break;
+                        case 3: (void)client.check_async().get(); break;
+                    }
+                    writes++;
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        running = false;
+        for (auto& thread : threads) thread.join();
+        client.stop_heartbeat();
+
+        printf("  %ld reads, %d writes, %lu heartbeats, version %llu\n", reads.load(), writes.load(),
+            (unsigned long)client.get_heartbeat_stats().beats, client.session()->version);
+        CHECK(inconsistent == 0);
+        CHECK(backwards == 0);
+        CHECK(writes > 0);
+        CHECK(client.get_heartbeat_stats().beats > 0);
+    }
+
+    struct Counted {
+        static inline std::atomic<int> alive{0};
+        int value;
+
+        explicit Counted(int value) : value(value) { alive++; }
+        ~Counted() { alive--; }
+    };
+
+    void replaced_values_are_freed_once_unread() {
+        using Published = published::Value<Counted, 4>;
+        static_assert(Published::is_lock_free(), "session reads must not take a lock");
+
+        constexpr int threads_reading = 16; // four per slot
+        constexpr int stores = 20000;
+        {
+            Published value;
+            value.store(std::make_shared<const Counted>(0));
+
+            std::atomic<bool> running{true};
+            std::atomic<long> backwards{0};
+            std::vector<std::thread> threads;
+            for (int r = 0; r < threads_reading; ++r) {
+                threads.emplace_back([&] {
+                    int last = 0;
+                    while (running) {
+                        const auto current = value.load();
+                        if (current->value < last) backwards++;
+                        last = current->value;
+                    }
+                });
+            }
+
+            // One held value survives every store after it
+            const auto held = value.load();
+            for (int i = 1; i <= stores; ++i) value.store(std::make_shared<const Counted>(i));
+            running = false;
+            for (auto& thread : threads) thread.join();
+
+            CHECK(backwards == 0);
+            CHECK(held->value == 0);
+            CHECK(value.load()->value == stores);
+
+            // With no reader left, the next store frees every replaced value nobody holds
+            value.store(std::make_shared<const Counted>(-1));
+            CHECK(Counted::alive == 2);
+        }
+        CHECK(Counted::alive == 0);
+    }
+}
+
+int main() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    check::run("snapshots stay consistent under writers", snapshots_stay_consistent_under_writers);
+    check::run("replaced values are freed once unread", replaced_values_are_freed_once_unread);
+
+    curl_global_cleanup();
+    return 0;
+}
@@ -0,0 +1,164 @@
+// c_static_layer on the headless backend: replayed chrome must be the geometry immediate drawing
+// produces, at the window's current position, and it is only tessellated again on a resize or a
+// style change. Built only when imgui/ is present.
+#include "headless.hpp"
+#include "static_layer.hpp"
+#include "check.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+    // Same kinds of shapes as the window chrome in main.hpp
+    void chrome( ImDrawList* draw_list ) {
+        const ImVec2 pos = ImGui::GetWindowPos( );
+        const ImVec2 size = ImGui::GetWindowSize( );
+        const ImU32 border = ImGui::GetColorU32( ImGuiCol_Border );
+        const ImU32 accent = ImGui::GetColorU32( ImGuiCol_CheckMark );
+
+        draw_list->AddRect( pos, { pos.x + size.x, pos.y + size.y }, border );
+        draw_list->AddQuadFilled( { pos.x + 60, pos.y }, { pos.x + 30, pos.y }, { pos.x + 30, pos.y + 26 }, { pos.x + 50, pos.y + 26 }, accent );
+        draw_list->AddLine( { pos.x, pos.y + 24 }, { pos.x + size.x, pos.y + 24 }, border );
+        draw_list->AddRectFilledMultiColor( { pos.x + size.x / 2, pos.y + 25 }, { pos.x + size.x, pos.y + 26 }, 0, accent, accent, 0 );
+    }
+
+    struct geometry_t {
+        std::vector< ImDrawVert > vertices;
+        std::vector< ImDrawIdx > indices;
+        c_static_layer::frame_stats_t stats;
+    };
+
+    // One frame with a window at pos/size whose chrome goes through layer, or is drawn directly
+    // without one; returns what the chrome added to the window's draw list
+    geometry_t render( c_headless& headless, c_static_layer* layer, ImVec2 pos, ImVec2 size ) {
+        geometry_t out;
+        {
+            c_headless_frame frame( headless );
+            if ( layer )
+                layer->new_frame( );
+
+            ImGui::SetNextWindowPos( pos );
+            ImGui::SetNextWindowSize( size );
+            ImGui::Begin( "chrome", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoBackground );
+
+            ImDrawList* draw_list = ImGui::GetWindowDrawList( );
+            const int first_vertex = draw_list->VtxBuffer.Size;
+            const int first_index = draw_list->IdxBuffer.Size;
+            if ( layer )
+                layer->draw( draw_list, ImGui::GetID( "##chrome" ), ImGui::GetWindowPos( ), ImGui::GetWindowSize( ), chrome );
+            else
+                chrome( draw_list );
+
+            out.vertices.assign( draw_list->VtxBuffer.Data + first_vertex, draw_list->VtxBuffer.Data + draw_list->VtxBuffer.Size );
+            out.indices.assign( draw_list->IdxBuffer.Data + first_index, draw_list->IdxBuffer.Data + draw_list->IdxBuffer.Size );
+            ImGui::End( );
+        }
+
+        // Roll this frame's counters over so they can be read now
+        if ( layer ) {
+            layer->new_frame( );
+            out.stats = layer->get_last_frame_stats( );
+        }
+        return out;
+    }
+
+    bool same( const geometry_t& a, const geometry_t& b ) {
+        if ( a.vertices.size( ) != b.vertices.size( ) || a.indices != b.indices )
+            return false;
+
+        for ( size_t i = 0; i < a.vertices.size( ); ++i ) {
+            const ImDrawVert& x = a.vertices[i];
+            const ImDrawVert& y = b.vertices[i];
+            // Cached positions are stored relative to the window and moved back, so allow rounding
+            if ( std::fabs( x.pos.x - y.pos.x ) > 1e-3f || std::fabs( x.pos.y - y.pos.y ) > 1e-3f )
+                return false;
+            if ( x.uv.x != y.uv.x || x.uv.y != y.uv.y || x.col != y.col )
+                return false;
+        }
+        return true;
+    }
+
+    struct fixture_t {
+        c_headless headless{ { 800, 600 } };
+
+        fixture_t( ) {
+            headless.build_fonts( );
+        }
+    };
+
+    void replays_the_same_geometry( ) {
+        fixture_t fixture;
+        c_static_layer layer;
+        const ImVec2 pos{ 40, 30 }, size{ 400, 300 };
+
+        const geometry_t direct = render( fixture.headless, nullptr, pos, size );
+        CHECK( !direct.vertices.empty( ) );
+
+        const geometry_t built = render( fixture.headless, &layer, pos, size );
+        CHECK( built.stats.rebuilds == 1 );
+        CHECK( built.stats.vertices_built == direct.vertices.size( ) );
+        CHECK( same( built, direct ) );
+
+        for ( int i = 0; i < 5; ++i ) {
+            const geometry_t cached = render( fixture.headless, &layer, pos, size );
+            CHECK( cached.stats.rebuilds == 0 );
+            CHECK( cached.stats.vertices_built == 0 );
+            CHECK( cached.stats.vertices_cached == direct.vertices.size( ) );
+            CHECK( same( cached, direct ) );
+        }
+    }
+
+    void follows_the_window_without_rebuilding( ) {
+        fixture_t fixture;
+        c_static_layer layer;
+        const ImVec2 size{ 400, 300 };
+
+        render( fixture.headless, &layer, { 40, 30 }, size );
+        const geometry_t moved = render( fixture.headless, &layer, { 120, 75 }, size );
+        CHECK( moved.stats.rebuilds == 0 );
+        CHECK( same( moved, render( fixture.headless, nullptr, { 120, 75 }, size ) ) );
+    }
+
+    void rebuilds_on_resize_and_style_change( ) {
+        fixture_t fixture;
+        c_static_layer layer;
+        const ImVec2 pos{ 40, 30 };
+
+        render( fixture.headless, &layer, pos, { 400, 300 } );
+
+        const geometry_t resized = render( fixture.headless, &layer, pos, { 500, 320 } );
+        CHECK( resized.stats.rebuilds == 1 );
+        CHECK( same( resized, render( fixture.headless, nullptr, pos, { 500, 320 } ) ) );
+
+        ImGui::GetStyle( ).Colors[ImGuiCol_Border] = ImVec4( 1.f, 0.f, 0.f, 1.f );
+        const geometry_t restyled = render( fixture.headless, &layer, pos, { 500, 320 } );
+        CHECK( restyled.stats.rebuilds == 1 );
+        CHECK( same( restyled, render( fixture.headless, nullptr, pos, { 500, 320 } ) ) );
+
+        CHECK( render( fixture.headless, &layer, pos, { 500, 320 } ).stats.rebuilds == 0 );
+    }
+
+    void disabled_draws_immediately( ) {
+        fixture_t fixture;
+        c_static_layer layer;
+        layer.set_enabled( false );
+        const ImVec2 pos{ 40, 30 }, size{ 400, 300 };
+
+        const geometry_t direct = render( fixture.headless, nullptr, pos, size );
+        for ( int i = 0; i < 3; ++i ) {
+            const geometry_t frame = render( fixture.headless, &layer, pos, size );
+            CHECK( frame.stats.rebuilds == 0 );
+            CHECK( frame.stats.vertices_cached == 0 );
+            CHECK( frame.stats.vertices_built == direct.vertices.size( ) );
+            CHECK( same( frame, direct ) );
+        }
+    }
+}
+
+int main( ) {
+    check::run( "replays the same geometry", replays_the_same_geometry );
+    check::run( "follows the window without rebuilding", follows_the_window_without_rebuilding );
+    check::run( "rebuilds on resize and style change", rebuilds_on_resize_and_style_change );
+    check::run( "disabled draws immediately", disabled_draws_immediately );
+    return 0;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "ui/ui.hpp"
+#include <string>
+#include <list>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <type_traits>
+
+// Frame-persistent cache of formatted and measured text. Entries are keyed by the font, size,
+// format string and the printf arguments themselves, so a hit skips both snprintf and
+// text_size; entries only change when one of those inputs changes. Least recently used
+// entries are evicted once the cache grows past max_bytes.
+class c_text_cache {
+public:
+    // References stay valid until the next lookup
+    struct entry_t {
+        std::string text;
+        ImVec2 size;
+        size_t visible_length = 0; // up to any "##" suffix, like FindRenderedTextEnd
+
+        const char* begin( ) const { return text.c_str( ); }
+        const char* end( ) const { return text.c_str( ) + visible_length; }
+    };
+
+    struct frame_stats_t {
+        unsigned int hits = 0;
+        unsigned int misses = 0;
+    };
+
+    explicit c_text_cache( size_t max_bytes = 64 * 1024 ) : max_bytes( max_bytes ) {}
+
+    // Call once per frame before any lookups
+    void new_frame( ) {
+        last_frame = current_frame;
+        current_frame = {};
+    }
+
+    frame_stats_t get_last_frame_stats( ) const {
+        return last_frame;
+    }
+
+    template< class font_t >
+    const entry_t& get( font_t font, int size, const char* text ) {
+        begin_key( font, size, text );
+        return lookup( [&]( std::string& out ) { out = text; }, font, size );
+    }
+
+    template< class font_t, class... args_t >
+    const entry_t& format( font_t font, int size, const char* fmt, const args_t&... args ) {
+        begin_key( font, size, fmt );
+        ( append_arg( args ), ... );
+
+        return lookup( [&]( std::string& out ) {
+            char buf[256];
+            snprintf( buf, sizeof( buf ), fmt, args... );
+            out = buf;
+        }, font, size );
+    }
+
+private:
+    struct node_t {
+        std::string key;
+        entry_t entry;
+    };
+
+    size_t max_bytes;
+    size_t used_bytes = 0;
+    std::list< node_t > lru; // front = most recently used
+    std::unordered_map< std::string, std::list< node_t >::iterator > index;
+    std::string scratch; // reused key buffer, so lookups don't allocate once warm
+
+    frame_stats_t current_frame;
+    frame_stats_t last_frame;
+
+    template< class value_t >
+    void append_bytes( const value_t& value ) {
+        scratch.append( ( const char* )&value, sizeof( value ) );
+    }
+
+    void append_string( const char* text ) {
+        scratch.append( text ? text : "(null)" );
+        scratch.push_back( '\0' );
+    }
+
+    template< class arg_t >
+    void append_arg( const arg_t& arg ) {
+        if constexpr ( std::is_convertible_v< arg_t, const char* > ) {
+            append_string( arg );
+        } else {
+            static_assert( std::is_arithmetic_v< arg_t > || std::is_enum_v< arg_t >, "text cache args must be printf scalars or C strings" );
+            append_bytes( arg );
+        }
+    }
+
+    template< class font_t >
+    void begin_key( font_t font, int size, const char* fmt ) {
+        scratch.clear( );
+        append_bytes( font );
+        append_bytes( size );
+        append_string( fmt );
+    }
+
+    // Node plus the key copy held by the index
+    static size_t cost( const node_t& node ) {
+        return sizeof( node_t ) + 2 * node.key.capacity( ) + node.entry.text.capacity( );
+    }
+
+    template< class fill_t, class font_t >
+    const entry_t& lookup( fill_t&& fill, font_t font, int size ) {
+        auto it = index.find( scratch );
+        if ( it != index.end( ) ) {
+            current_frame.hits++;
+            lru.splice( lru.begin( ), lru, it->second );
+            return it->second->entry;
+        }
+
+        current_frame.misses++;
+
+        node_t node;
+        node.key = scratch;
+        fill( node.entry.text );
+        node.entry.size = text_size( font, size, node.entry.text.c_str( ) );
+        node.entry.visible_length = ImGui::FindRenderedTextEnd( node.entry.text.c_str( ) ) - node.entry.text.c_str( );
+
+        used_bytes += cost( node );
+        lru.push_front( std::move( node ) );
+        index.emplace( lru.front( ).key, lru.begin( ) );
+
+        // Never evict the entry we are about to return
+        while ( used_bytes > max_bytes && lru.size( ) > 1 ) {
+            const node_t& victim = lru.back( );
+            used_bytes -= cost( victim );
+            index.erase( victim.key );
+            lru.pop_back( );
+        }
+
+        return lru.front( ).entry;
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+#include <ctime>
+#include <cstdlib>
+#include <curl/curl.h>
+#include "hex.hpp"
+#include "secure_file.hpp"
+
+// TLS session tickets kept on disk between runs, so the first connection of a new process
+// resumes the previous session (one round trip, no certificate chain) instead of doing a full
+// handshake.
+//
+// Uses curl_easy_ssls_export/import, added in libcurl 8.12; older versions build with both
+// functions as no-ops. The handle must use a share with CURL_LOCK_DATA_SSL_SESSION, which is
+// where libcurl keeps the sessions. The file holds resumption secrets: it is DPAPI-protected on
+// Windows and created with mode 0600 elsewhere (see secure_file.hpp).
+namespace tls_cache {
+    inline const char* const magic = "KATLS1";
+
+#if LIBCURL_VERSION_NUM >= 0x080c00
+    struct Writer {
+        std::string text;
+        int sessions = 0;
+    };
+
+    // Four lines per session: key ("-" if libcurl only gave the salted hash), hash, ticket, expiry
+    inline CURLcode write_session(CURL*, void* userptr, const char* session_key, const unsigned char* shmac, size_t shmac_len,
+                                  const unsigned char* sdata, size_t sdata_len, curl_off_t valid_until, int, const char*, size_t) {
+        Writer& writer = *(Writer*)userptr;
+        writer.text += session_key ? session_key : "-";
+        writer.text += "\n" + hex::encode(shmac, shmac_len) + "\n" + hex::encode(sdata, sdata_len) + "\n" + std::to_string((long long)valid_until) + "\n";
+        writer.sessions++;
+        return CURLE_OK;
+    }
+
+    // Returns the number of sessions written, or -1 if nothing was written: the file could not
+    // be written or protected, or libcurl was built without SSLS-EXPORT (curl_easy_ssls_export
+    // returns CURLE_NOT_BUILT_IN), in which case the previous file is left alone
+    inline int save(CURL* handle, const std::string& path) {
+        if (path.empty()) return 0;
+
+        Writer writer;
+        writer.text = std::string(magic) + "\n";
+        if (curl_easy_ssls_export(handle, write_session, &writer) != CURLE_OK) return -1;
+
+        std::string blob;
+#ifdef _WIN32
+        if (!secure_file::protect(writer.text, "", L"KeyAuth TLS sessions", blob)) return -1;
+#else
+        blob.swap(writer.text);
+#endif
+        return secure_file::write_private(path, blob) ? writer.sessions : -1;
+    }
+
+    // Imports every session that has not expired (0 means no known expiry); returns how many were accepted
+    inline int load(CURL* handle, const std::string& path) {
+        if (path.empty()) return 0;
+
+        std::string text;
+        if (!secure_file::read(path, text)) return 0;
+#ifdef _WIN32
+        std::string blob;
+        blob.swap(text);
+        if (!secure_file::unprotect(blob, "", text)) return 0;
+#endif
+
+        std::istringstream file(text);
+        std::string header;
+        if (!std::getline(file, header) || header != magic) return 0;
+
+        int imported = 0;
+        const long long now = (long long)time(nullptr);
+        std::string key, shmac_hex, sdata_hex, expiry;
+        while (std::getline(file, key) && std::getline(file, shmac_hex) && std::getline(file, sdata_hex) && std::getline(file, expiry)) {
+            const long long valid_until = std::strtoll(expiry.c_str(), nullptr, 10);
+            if (valid_until > 0 && valid_until <= now) continue;
+
+            std::vector<unsigned char> shmac, sdata;
+            if (!hex::decode(shmac_hex, shmac) || !hex::decode(sdata_hex, sdata) || sdata.empty()) continue;
+
+            CURLcode result = curl_easy_ssls_import(handle, key == "-" ? nullptr : key.c_str(),
+                                                    shmac.empty() ? nullptr : shmac.data(), shmac.size(), sdata.data(), sdata.size());
+            if (result == CURLE_OK) ++imported;
+        }
+        return imported;
+    }
+#else
+    inline int save(CURL*, const std::string&) {
+        return 0;
+    }
+
+    inline int load(CURL*, const std::string&) {
+        return 0;
+    }
+#endif
+}
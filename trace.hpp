@@ -0,0 +1,237 @@
+#pragma once
+
+// Timeline tracing across startup, network calls and frames, exported as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev).
+//
+//     KEYAUTH_TRACE_SCOPE("font atlas");          // complete event for the enclosing scope
+//     KEYAUTH_TRACE_SCOPE("request", "login");    // with a detail shown under args
+//     KEYAUTH_TRACE_THREAD("network");            // names the calling thread in the viewer
+//
+// Everything is compiled in with KEYAUTH_TRACE. Without it the macros expand to nothing and
+// the functions below are empty inline stubs, so call sites need no #ifdef.
+//
+// Each thread appends to its own fixed-size ring buffer (the oldest events are overwritten),
+// so recording is a clock read and a few relaxed stores, never a lock. Names and details must
+// be string literals or otherwise outlive the export.
+#ifdef KEYAUTH_TRACE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace trace {
+    inline constexpr bool enabled = true;
+    inline constexpr size_t buffer_events = 8192; // per thread
+
+    // Raw steady_clock time; the export makes it relative to when tracing started
+    inline uint64_t to_ns(std::chrono::steady_clock::time_point time) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+
+    inline uint64_t now_ns() {
+        return to_ns(std::chrono::steady_clock::now());
+    }
+
+    struct Event {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<const char*> detail{nullptr};
+        std::atomic<uint64_t> start_ns{0};
+        std::atomic<uint64_t> duration_ns{0};
+    };
+
+    // Written only by its thread; head counts every event ever written and is published
+    // after the slot, so a reader knows which slots are complete
+    struct Buffer {
+        int tid = 0;
+        std::atomic<const char*> thread_name{nullptr};
+        std::atomic<uint64_t> head{0};
+        Event events[buffer_events];
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Buffer>> buffers; // kept after their thread exits
+        std::string exit_path;
+        uint64_t epoch_ns = to_ns(std::chrono::steady_clock::now());
+    };
+
+    inline Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    inline Buffer& local_buffer() {
+        thread_local std::shared_ptr<Buffer> buffer = [] {
+            auto created = std::make_shared<Buffer>();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            created->tid = (int)r.buffers.size() + 1;
+            r.buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    // Records an event that ran from start_ns to end_ns (now_ns() values) on the calling thread
+    inline void complete(const char* name, const char* detail, uint64_t start_ns, uint64_t end_ns) {
+        Buffer& buffer = local_buffer();
+        const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+        // Orders the previous head store before the slot stores, so a reader that sees any of
+        // them also sees that this slot is being rewritten (seqlock-style, see export_json)
+        std::atomic_thread_fence(std::memory_order_release);
+        Event& event = buffer.events[index % buffer_events];
+        event.name.store(name, std::memory_order_relaxed);
+        event.detail.store(detail, std::memory_order_relaxed);
+        event.start_ns.store(start_ns, std::memory_order_relaxed);
+        event.duration_ns.store(end_ns - start_ns, std::memory_order_relaxed);
+        buffer.head.store(index + 1, std::memory_order_release);
+    }
+
+    inline void set_thread_name(const char* name) {
+        local_buffer().thread_name.store(name, std::memory_order_relaxed);
+    }
+
+    class Scope {
+    public:
+        explicit Scope(const char* name, const char* detail = nullptr) : name(name), detail(detail), start_ns(now_ns()) {}
+
+        ~Scope() {
+            complete(name, detail, start_ns, now_ns());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        const char* detail;
+        uint64_t start_ns;
+    };
+
+    inline void append_escaped(std::string& out, const char* text) {
+        for (const char* c = text ? text : ""; *c; ++c) {
+            if (*c == '"' || *c == '\\') out += '\\';
+            if ((unsigned char)*c >= 0x20) out += *c;
+        }
+    }
+
+    // Chrome trace JSON for every event still held in the ring buffers. Safe to call while
+    // other threads keep recording; their newest events may just miss the snapshot.
+    inline std::string export_json() {
+        std::vector<std::shared_ptr<Buffer>> buffers;
+        Registry& r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            buffers = r.buffers;
+        }
+
+        std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        char number[96];
+
+        for (const auto& buffer : buffers) {
+            const char* thread_name = buffer->thread_name.load(std::memory_order_relaxed);
+            if (thread_name) {
+                out += first ? "" : ",";
+                first = false;
+                snprintf(number, sizeof(number), "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"", buffer->tid);
+                out += number;
+                append_escaped(out, thread_name);
+                out += "\"}}";
+            }
+
+            const uint64_t head = buffer->head.load(std::memory_order_acquire);
+            const uint64_t begin = head > buffer_events ? head - buffer_events : 0;
+            for (uint64_t index = begin; index < head; ++index) {
+                const Event& event = buffer->events[index % buffer_events];
+                const char* name = event.name.load(std::memory_order_relaxed);
+                const char* detail = event.detail.load(std::memory_order_relaxed);
+                const uint64_t start = event.start_ns.load(std::memory_order_relaxed);
+                const uint64_t duration = event.duration_ns.load(std::memory_order_relaxed);
+
+                // The owner may have wrapped around onto this slot while it was being read
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (buffer->head.load(std::memory_order_relaxed) >= index + buffer_events) continue;
+
+                out += first ? "" : ",";
+                first = false;
+                out += "{\"ph\":\"X\",\"pid\":1,\"name\":\"";
+                append_escaped(out, name);
+                const double ts = start > r.epoch_ns ? (start - r.epoch_ns) / 1000.0 : 0.0;
+                snprintf(number, sizeof(number), "\",\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", buffer->tid, ts, duration / 1000.0);
+                out += number;
+                if (detail) {
+                    out += ",\"args\":{\"detail\":\"";
+                    append_escaped(out, detail);
+                    out += "\"}";
+                }
+                out += "}";
+            }
+        }
+
+        out += "]}";
+        return out;
+    }
+
+    inline bool write(const std::string& path) {
+        const std::string json = export_json();
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) return false;
+        const bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+        return fclose(file) == 0 && written;
+    }
+
+    // Writes the trace to path when the process exits normally; the last call wins
+    inline void write_at_exit(const std::string& path) {
+        Registry& r = registry();
+        bool registered;
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            registered = !r.exit_path.empty();
+            r.exit_path = path;
+        }
+        if (!registered) std::atexit([] { write(registry().exit_path); });
+    }
+}
+
+#define KEYAUTH_TRACE_CONCAT_(a, b) a##b
+#define KEYAUTH_TRACE_CONCAT(a, b) KEYAUTH_TRACE_CONCAT_(a, b)
+#define KEYAUTH_TRACE_SCOPE(...) trace::Scope KEYAUTH_TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
+#define KEYAUTH_TRACE_THREAD(name) trace::set_thread_name(name)
+#else
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace trace {
+    inline constexpr bool enabled = false;
+
+    inline uint64_t to_ns(std::chrono::steady_clock::time_point) {
+        return 0;
+    }
+
+    inline uint64_t now_ns() {
+        return 0;
+    }
+
+    inline void complete(const char*, const char*, uint64_t, uint64_t) {}
+
+    inline std::string export_json() {
+        return "";
+    }
+
+    inline bool write(const std::string&) {
+        return false;
+    }
+
+    inline void write_at_exit(const std::string&) {}
+}
+
+#define KEYAUTH_TRACE_SCOPE(...) ((void)0)
+#define KEYAUTH_TRACE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,184 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <curl/curl.h>
+#include "hex.hpp"
+
+// Where KeyAuth sends its requests. By default the client drives libcurl itself; giving it a
+// Transport routes every request (blocking and async calls, retries, heartbeats, breaker
+// probes) through send() instead, with the client's retry, breaker, single-flight, metrics
+// and decoding logic unchanged on top. libcurl stays a dependency either way: failures are
+// reported as CURLcode values, and the async engine still uses a curl_multi handle as its
+// network thread's event loop (wakeups and timers). Only the curl share and the TLS session
+// cache are skipped when a Transport is given.
+//
+// Loopback is an in-process server for tests and benchmarks: no sockets, no TLS and no extra
+// threads. It reads the request body in place and writes the reply straight into the buffer
+// the client decodes from.
+namespace transport {
+    // One request's result. KeyAuth's own response type derives from this, so a transport
+    // fills the client's buffers directly.
+    struct Response {
+        std::string data;
+        long response_code = 0;          // HTTP status; stays 0 when result is an error
+        CURLcode result = CURLE_OK;      // transport-level failure, in libcurl's terms
+        std::string signature;           // x-signature-ed25519
+        std::string signature_timestamp; // x-signature-timestamp
+    };
+
+    // Views of the client's buffers, valid until send() returns
+    struct Request {
+        std::string_view url;
+        std::string_view body; // "type=<endpoint>&field=value...", values percent-encoded
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    class Transport {
+    public:
+        virtual ~Transport() = default;
+
+        // Fills response for request. Called from callers' threads for blocking calls and from
+        // the client's network thread for async ones, possibly at the same time.
+        virtual void send(const Request& request, Response& response) = 0;
+    };
+
+    // Value of a form field, still percent-encoded; empty if absent
+    inline std::string_view param(std::string_view body, std::string_view name) {
+        while (!body.empty()) {
+            const size_t end = body.find('&');
+            const std::string_view pair = body.substr(0, end);
+            if (pair.size() > name.size() && pair[name.size()] == '=' && pair.compare(0, name.size(), name) == 0) {
+                return pair.substr(name.size() + 1);
+            }
+            if (end == std::string_view::npos) break;
+            body.remove_prefix(end + 1);
+        }
+        return {};
+    }
+
+    // Appends a percent-encoded form value to out as the contents of a JSON string
+    inline void append_json_value(std::string& out, std::string_view encoded) {
+        using hex::nibble;
+
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            unsigned char c = (unsigned char)encoded[i];
+            if (c == '+') c = ' ';
+            else if (c == '%' && i + 2 < encoded.size() && nibble(encoded[i + 1]) >= 0 && nibble(encoded[i + 2]) >= 0) {
+                c = (unsigned char)(nibble(encoded[i + 1]) << 4 | nibble(encoded[i + 2]));
+                i += 2;
+            }
+
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char)c;
+            } else if (c < 0x20) {
+                out += "\\u00";
+                out += hex::digits[c >> 4];
+                out += hex::digits[c & 0x0F];
+            } else {
+                out += (char)c;
+            }
+        }
+    }
+
+    class Loopback : public Transport {
+    public:
+        using Handler = std::function<void(const Request&, Response&)>;
+
+        // Answers requests of this type (init, login, ...; "" for a body without one) with handler
+        void on(const std::string& type, Handler handler) {
+            auto shared = std::make_shared<const Handler>(std::move(handler));
+            std::lock_guard<std::mutex> lock(mutex);
+            handlers[type] = std::move(shared);
+        }
+
+        // Fixed reply for a type
+        void reply(const std::string& type, std::string body, long status = 200) {
+            on(type, [body = std::move(body), status](const Request&, Response& response) {
+                response.response_code = status;
+                response.data = body;
+            });
+        }
+
+        // Transport failure for a type, e.g. CURLE_COULDNT_CONNECT or CURLE_OPERATION_TIMEDOUT
+        void fail(const std::string& type, CURLcode result) {
+            on(type, [result](const Request&, Response& response) { response.result = result; });
+        }
+
+        unsigned long requests(const std::string& type) const {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = counts.find(type);
+            return it == counts.end() ? 0 : it->second;
+        }
+
+        void send(const Request& request, Response& response) override {
+            const std::string type(param(request.body, "type"));
+            std::shared_ptr<const Handler> handler;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                counts[type]++;
+                auto it = handlers.find(type);
+                if (it != handlers.end()) handler = it->second;
+            }
+
+            // Handlers run unlocked, so they may be called concurrently
+            if (handler) {
+                (*handler)(request, response);
+            } else {
+                response.response_code = 200;
+                response.data = "{\"success\":false,\"message\":\"Unhandled request type\"}";
+            }
+        }
+
+    private:
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const Handler>> handlers;
+        std::unordered_map<std::string, unsigned long> counts;
+    };
+
+    // A loopback scripted like the 1.2 API: init opens session_id, login/license/register
+    // accept any credentials and report one subscription, check validates session_id.
+    // Individual endpoints can be re-scripted with on()/reply()/fail() afterwards.
+    inline std::shared_ptr<Loopback> keyauth_loopback(const std::string& session_id = "loopback") {
+        auto server = std::make_shared<Loopback>();
+
+        server->reply("init", "{\"success\":true,\"message\":\"Initialized\",\"sessionid\":\"" + session_id + "\"}");
+
+        auto login = [](std::string_view username, std::string_view hwid, const char* message, std::string& out) {
+            out = "{\"success\":true,\"message\":\"";
+            out += message;
+            out += "\",\"info\":{\"username\":\"";
+            append_json_value(out, username);
+            out += "\",\"ip\":\"127.0.0.1\",\"hwid\":\"";
+            append_json_value(out, hwid);
+            out += "\",\"createdate\":\"1700000000\",\"lastlogin\":\"1700000100\",\"subscriptions\":["
+                   "{\"subscription\":\"default\",\"key\":null,\"expiry\":\"4102444800\",\"timeleft\":1}]}}";
+        };
+
+        server->on("login", [login](const Request& request, Response& response) {
+            response.response_code = 200;
+            login(param(request.body, "username"), param(request.body, "hwid"), "Logged in!", response.data);
+        });
+        server->on("license", [login](const Request& request, Response& response) {
+            response.response_code = 200;
+            login(param(request.body, "key"), param(request.body, "hwid"), "Logged in!", response.data);
+        });
+        server->on("register", [login](const Request& request, Response& response) {
+            response.response_code = 200;
+            login(param(request.body, "username"), param(request.body, "hwid"), "Registered!", response.data);
+        });
+        server->on("check", [session_id](const Request& request, Response& response) {
+            response.response_code = 200;
+            response.data = param(request.body, "sessionid") == session_id
+                ? "{\"success\":true,\"message\":\"Session is validated.\"}"
+                : "{\"success\":false,\"message\":\"Session not found.\"}";
+        });
+
+        return server;
+    }
+}